@@ -27,6 +27,7 @@ class b2Fixture;
 class b2Body;
 class b2Joint;
 class b2Contact;
+class b2ParticleSystem;
 struct b2ContactResult;
 struct b2Manifold;
 
@@ -128,6 +129,15 @@ public:
 	/// Called for each fixture found in the query AABB.
 	/// @return false to terminate the query.
 	virtual bool ReportFixture(b2Fixture* fixture) = 0;
+
+	/// Called for each particle found in the query AABB.
+	/// @return false to stop reporting particles of this particle system.
+	virtual bool ReportParticle(const b2ParticleSystem* particleSystem, int32 index)
+	{
+		B2_NOT_USED(particleSystem);
+		B2_NOT_USED(index);
+		return false;
+	}
 };
 
 /// Callback class for ray casts.
@@ -0,0 +1,802 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Particle/b2ParticleSystem.h>
+#include <Box2D/Collision/b2Collision.h>
+#include <Box2D/Dynamics/b2World.h>
+#include <Box2D/Dynamics/b2WorldCallbacks.h>
+#include <memory.h>
+#include <new>
+
+// Grow a particle or spring buffer, keeping the first count elements.
+template <typename T>
+static T* b2ReallocateBuffer(T* oldBuffer, int32 count, int32 capacity)
+{
+	b2Assert(capacity >= count);
+	T* newBuffer = (T*)b2Alloc(sizeof(T) * capacity);
+	if (oldBuffer)
+	{
+		memcpy(newBuffer, oldBuffer, sizeof(T) * count);
+		b2Free(oldBuffer);
+	}
+	return newBuffer;
+}
+
+b2ParticleSystem::b2ParticleSystem(const b2ParticleSystemDef* def, b2World* world)
+{
+	b2Assert(def->radius > 0.0f);
+	b2Assert(def->density > 0.0f);
+	b2Assert(def->tileSize > 0);
+
+	m_def = *def;
+	m_world = world;
+	m_particleMass = def->density * b2_pi * def->radius * def->radius;
+	m_particleInvMass = 1.0f / m_particleMass;
+
+	m_count = 0;
+	m_capacity = 0;
+	m_positionBuffer = NULL;
+	m_velocityBuffer = NULL;
+	m_flagsBuffer = NULL;
+	m_dampingBuffer = NULL;
+
+	m_springCount = 0;
+	m_springCapacity = 0;
+	m_springBuffer = NULL;
+
+	m_tileCount = 0;
+	m_tileBuffer = NULL;
+	m_particleTileBuffer = NULL;
+	m_tileParticleBuffer = NULL;
+	m_tileNeighborCount = 0;
+	m_tileNeighborBuffer = NULL;
+	m_simulatedTileCount = 0;
+	m_simulatedTiles = NULL;
+	m_liveTileCount = 0;
+	m_liveTiles = NULL;
+
+	m_gridDirty = true;
+	m_gridLower.SetZero();
+	m_gridInvCellSize = 0.0f;
+	m_gridColumns = 0;
+	m_gridRows = 0;
+	m_gridCellCapacity = 0;
+	m_gridCellStart = NULL;
+	m_gridParticles = NULL;
+
+	m_groupList = NULL;
+
+	m_prev = NULL;
+	m_next = NULL;
+}
+
+b2ParticleSystem::~b2ParticleSystem()
+{
+	b2ParticleGroup* group = m_groupList;
+	while (group)
+	{
+		b2ParticleGroup* next = group->m_next;
+		group->~b2ParticleGroup();
+		b2Free(group);
+		group = next;
+	}
+
+	b2Free(m_positionBuffer);
+	b2Free(m_velocityBuffer);
+	b2Free(m_flagsBuffer);
+	b2Free(m_dampingBuffer);
+	b2Free(m_springBuffer);
+	b2Free(m_tileBuffer);
+	b2Free(m_particleTileBuffer);
+	b2Free(m_tileParticleBuffer);
+	b2Free(m_tileNeighborBuffer);
+	b2Free(m_simulatedTiles);
+	b2Free(m_liveTiles);
+	b2Free(m_gridCellStart);
+	b2Free(m_gridParticles);
+}
+
+void b2ParticleSystem::ReallocateParticles(int32 capacity)
+{
+	if (capacity <= m_capacity)
+	{
+		return;
+	}
+
+	m_positionBuffer = b2ReallocateBuffer(m_positionBuffer, m_count, capacity);
+	m_velocityBuffer = b2ReallocateBuffer(m_velocityBuffer, m_count, capacity);
+	m_flagsBuffer = b2ReallocateBuffer(m_flagsBuffer, m_count, capacity);
+	m_dampingBuffer = b2ReallocateBuffer(m_dampingBuffer, m_count, capacity);
+	m_particleTileBuffer = b2ReallocateBuffer(m_particleTileBuffer, m_count, capacity);
+	m_tileParticleBuffer = b2ReallocateBuffer(m_tileParticleBuffer, m_count, capacity);
+	m_gridParticles = b2ReallocateBuffer(m_gridParticles, 0, capacity);
+	m_capacity = capacity;
+}
+
+void b2ParticleSystem::ReallocateSprings(int32 capacity)
+{
+	if (capacity <= m_springCapacity)
+	{
+		return;
+	}
+
+	m_springBuffer = b2ReallocateBuffer(m_springBuffer, m_springCount, capacity);
+	m_springCapacity = capacity;
+}
+
+inline float32 b2ParticleSystem::GetInverseMass(int32 index) const
+{
+	// Walls and particles of tiles left out of this step do not move.
+	if ((m_flagsBuffer[index] & b2_wallParticle) || !m_tileBuffer[m_particleTileBuffer[index]].simulated)
+	{
+		return 0.0f;
+	}
+	return m_particleInvMass;
+}
+
+void b2ParticleSystem::AddSpring(int32 indexA, int32 indexB, float32 length, const b2ParticleGroupDef& def)
+{
+	// A spring between two walls can never do anything.
+	if ((m_flagsBuffer[indexA] & m_flagsBuffer[indexB]) & b2_wallParticle)
+	{
+		return;
+	}
+
+	b2Assert(m_springCount < m_springCapacity);
+	Spring* spring = m_springBuffer + m_springCount;
+	spring->indexA = indexA;
+	spring->indexB = indexB;
+	spring->length = length;
+	spring->frequencyHz = def.frequencyHz;
+	spring->dampingRatio = def.dampingRatio;
+	spring->u.SetZero();
+	spring->invMassA = 0.0f;
+	spring->invMassB = 0.0f;
+	spring->mass = 0.0f;
+	spring->gamma = 0.0f;
+	spring->bias = 0.0f;
+	spring->impulse = 0.0f;
+	++m_springCount;
+}
+
+b2ParticleGroup* b2ParticleSystem::CreateParticleGroup(const b2ParticleGroupDef& def)
+{
+	b2Assert(m_world->IsLocked() == false);
+	if (m_world->IsLocked())
+	{
+		return NULL;
+	}
+
+	b2Assert(def.columnCount > 0 && def.rowCount > 0);
+	b2Assert(def.spacing > 0.0f);
+	b2Assert(def.frequencyHz > 0.0f);
+	b2Assert(def.absorbingWidth >= 0 && def.absorbingDamping >= 0.0f);
+
+	int32 firstIndex = m_count;
+	int32 firstSpring = m_springCount;
+	int32 particleCount = def.columnCount * def.rowCount;
+	ReallocateParticles(m_count + particleCount);
+
+	for (int32 row = 0; row < def.rowCount; ++row)
+	{
+		for (int32 column = 0; column < def.columnCount; ++column)
+		{
+			// Distance in rows or columns to the nearest border particle.
+			int32 depth = b2Min(b2Min(row, def.rowCount - 1 - row),
+								b2Min(column, def.columnCount - 1 - column));
+			bool border = depth == 0;
+
+			float32 damping = 0.0f;
+			if (!border && depth <= def.absorbingWidth)
+			{
+				float32 x = float32(def.absorbingWidth + 1 - depth) / def.absorbingWidth;
+				damping = def.absorbingDamping * x * x;
+			}
+
+			int32 index = m_count++;
+			m_positionBuffer[index].Set(def.origin.x + column * def.spacing,
+										def.origin.y + row * def.spacing);
+			m_velocityBuffer[index].SetZero();
+			m_flagsBuffer[index] = border ? def.borderFlags : def.flags;
+			m_dampingBuffer[index] = damping;
+		}
+	}
+
+	// Horizontal, vertical and (optionally) diagonal links to the previous
+	// column and row.
+	int32 linksPerParticle = def.diagonalSprings ? 3 : 2;
+	ReallocateSprings(m_springCount + linksPerParticle * particleCount);
+
+	float32 diagonalLength = b2Sqrt(2.0f) * def.spacing;
+	for (int32 row = 0; row < def.rowCount; ++row)
+	{
+		for (int32 column = 0; column < def.columnCount; ++column)
+		{
+			int32 index = firstIndex + row * def.columnCount + column;
+			if (column > 0)
+			{
+				AddSpring(index - 1, index, def.spacing, def);
+			}
+			if (row > 0)
+			{
+				AddSpring(index - def.columnCount, index, def.spacing, def);
+			}
+			if (def.diagonalSprings && column > 0 && row > 0)
+			{
+				AddSpring(index - def.columnCount - 1, index, diagonalLength, def);
+			}
+		}
+	}
+
+	CreateTiles(firstIndex, firstSpring, def);
+
+	void* mem = b2Alloc(sizeof(b2ParticleGroup));
+	b2ParticleGroup* group = new (mem) b2ParticleGroup;
+	group->m_firstIndex = firstIndex;
+	group->m_lastIndex = m_count;
+	group->m_columnCount = def.columnCount;
+	group->m_rowCount = def.rowCount;
+	group->m_origin = def.origin;
+	group->m_spacing = def.spacing;
+
+	group->m_prev = NULL;
+	group->m_next = m_groupList;
+	if (m_groupList)
+	{
+		m_groupList->m_prev = group;
+	}
+	m_groupList = group;
+
+	m_gridDirty = true;
+
+	return group;
+}
+
+void b2ParticleSystem::CreateTiles(int32 firstIndex, int32 firstSpring, const b2ParticleGroupDef& def)
+{
+	int32 tileSize = m_def.tileSize;
+	int32 tileColumns = (def.columnCount + tileSize - 1) / tileSize;
+	int32 tileRows = (def.rowCount + tileSize - 1) / tileSize;
+	int32 firstTile = m_tileCount;
+	int32 tileCount = m_tileCount + tileColumns * tileRows;
+
+	m_tileBuffer = b2ReallocateBuffer(m_tileBuffer, m_tileCount, tileCount);
+	m_simulatedTiles = b2ReallocateBuffer(m_simulatedTiles, 0, tileCount);
+	m_liveTiles = b2ReallocateBuffer(m_liveTiles, 0, tileCount);
+	m_tileNeighborBuffer = b2ReallocateBuffer(m_tileNeighborBuffer, m_tileNeighborCount,
+											  m_tileNeighborCount + 8 * (tileCount - m_tileCount));
+
+	// The 8-connected neighbours of every tile.
+	for (int32 tileRow = 0; tileRow < tileRows; ++tileRow)
+	{
+		for (int32 tileColumn = 0; tileColumn < tileColumns; ++tileColumn)
+		{
+			Tile& tile = m_tileBuffer[firstTile + tileRow * tileColumns + tileColumn];
+			tile.neighborStart = m_tileNeighborCount;
+			for (int32 y = b2Max(tileRow - 1, 0); y <= b2Min(tileRow + 1, tileRows - 1); ++y)
+			{
+				for (int32 x = b2Max(tileColumn - 1, 0); x <= b2Min(tileColumn + 1, tileColumns - 1); ++x)
+				{
+					if (x != tileColumn || y != tileRow)
+					{
+						m_tileNeighborBuffer[m_tileNeighborCount++] = firstTile + y * tileColumns + x;
+					}
+				}
+			}
+			tile.neighborEnd = m_tileNeighborCount;
+			tile.sleepTime = 0.0f;
+			tile.awake = false;
+			tile.simulated = false;
+			tile.springsLive = false;
+			tile.particleStart = 0;
+			tile.springStart = 0;
+		}
+	}
+	m_tileCount = tileCount;
+
+	for (int32 row = 0; row < def.rowCount; ++row)
+	{
+		for (int32 column = 0; column < def.columnCount; ++column)
+		{
+			int32 tile = firstTile + (row / tileSize) * tileColumns + column / tileSize;
+			m_particleTileBuffer[firstIndex + row * def.columnCount + column] = tile;
+		}
+	}
+
+	// Counting sort of the group's particles by tile. particleEnd holds the
+	// counts until the prefix sum turns them into ranges.
+	for (int32 t = firstTile; t < tileCount; ++t)
+	{
+		m_tileBuffer[t].particleEnd = 0;
+	}
+	for (int32 i = firstIndex; i < m_count; ++i)
+	{
+		++m_tileBuffer[m_particleTileBuffer[i]].particleEnd;
+	}
+	int32 offset = firstIndex;
+	for (int32 t = firstTile; t < tileCount; ++t)
+	{
+		m_tileBuffer[t].particleStart = offset;
+		offset += m_tileBuffer[t].particleEnd;
+		m_tileBuffer[t].particleEnd = m_tileBuffer[t].particleStart;
+	}
+	for (int32 i = firstIndex; i < m_count; ++i)
+	{
+		m_tileParticleBuffer[m_tileBuffer[m_particleTileBuffer[i]].particleEnd++] = i;
+	}
+
+	// Counting sort of the group's springs by the tile of their second
+	// particle, so each tile owns a contiguous run of springs.
+	for (int32 t = firstTile; t < tileCount; ++t)
+	{
+		m_tileBuffer[t].springEnd = 0;
+	}
+	for (int32 i = firstSpring; i < m_springCount; ++i)
+	{
+		++m_tileBuffer[m_particleTileBuffer[m_springBuffer[i].indexB]].springEnd;
+	}
+	offset = firstSpring;
+	for (int32 t = firstTile; t < tileCount; ++t)
+	{
+		m_tileBuffer[t].springStart = offset;
+		offset += m_tileBuffer[t].springEnd;
+		m_tileBuffer[t].springEnd = m_tileBuffer[t].springStart;
+	}
+
+	int32 springCount = m_springCount - firstSpring;
+	Spring* sorted = (Spring*)b2Alloc(sizeof(Spring) * b2Max(springCount, 1));
+	for (int32 i = firstSpring; i < m_springCount; ++i)
+	{
+		const Spring& s = m_springBuffer[i];
+		sorted[m_tileBuffer[m_particleTileBuffer[s.indexB]].springEnd++ - firstSpring] = s;
+	}
+	memcpy(m_springBuffer + firstSpring, sorted, sizeof(Spring) * springCount);
+	b2Free(sorted);
+}
+
+void b2ParticleSystem::ResetParticleGroup(b2ParticleGroup* group)
+{
+	int32 firstIndex = group->m_firstIndex;
+	for (int32 row = 0; row < group->m_rowCount; ++row)
+	{
+		for (int32 column = 0; column < group->m_columnCount; ++column)
+		{
+			int32 index = firstIndex + row * group->m_columnCount + column;
+			m_positionBuffer[index].Set(group->m_origin.x + column * group->m_spacing,
+										group->m_origin.y + row * group->m_spacing);
+			m_velocityBuffer[index].SetZero();
+		}
+	}
+
+	// Groups are not linked to each other, so a spring belongs to the group
+	// of either of its particles.
+	for (int32 i = 0; i < m_springCount; ++i)
+	{
+		Spring& s = m_springBuffer[i];
+		if (firstIndex <= s.indexB && s.indexB < group->m_lastIndex)
+		{
+			s.impulse = 0.0f;
+		}
+	}
+
+	int32 firstTile = m_particleTileBuffer[firstIndex];
+	int32 lastTile = m_particleTileBuffer[group->m_lastIndex - 1];
+	for (int32 t = firstTile; t <= lastTile; ++t)
+	{
+		m_tileBuffer[t].awake = false;
+		m_tileBuffer[t].sleepTime = 0.0f;
+	}
+
+	m_gridDirty = true;
+}
+
+void b2ParticleSystem::SetParticleDamping(int32 index, int32 count, const float32* damping)
+{
+	b2Assert(0 <= index && index + count <= m_count);
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Assert(damping[i] >= 0.0f);
+		m_dampingBuffer[index + i] = damping[i];
+	}
+}
+
+int32 b2ParticleSystem::GetAwakeTileCount() const
+{
+	int32 count = 0;
+	for (int32 t = 0; t < m_tileCount; ++t)
+	{
+		count += m_tileBuffer[t].awake ? 1 : 0;
+	}
+	return count;
+}
+
+void b2ParticleSystem::WakeParticles(int32 index, int32 count)
+{
+	b2Assert(0 <= index && index + count <= m_count);
+	int32 lastTile = -1;
+	for (int32 i = index; i < index + count; ++i)
+	{
+		int32 t = m_particleTileBuffer[i];
+		if (t != lastTile)
+		{
+			m_tileBuffer[t].awake = true;
+			m_tileBuffer[t].sleepTime = 0.0f;
+			lastTile = t;
+		}
+	}
+}
+
+void b2ParticleSystem::UpdateSimulatedTiles()
+{
+	// Simulate the awake tiles and their neighbours, so a wavefront leaving an
+	// awake tile always moves into simulated particles. Tiles further out are
+	// at rest and act like walls for the springs that reach them.
+	for (int32 t = 0; t < m_tileCount; ++t)
+	{
+		Tile& tile = m_tileBuffer[t];
+		bool simulated = tile.awake;
+		for (int32 k = tile.neighborStart; k < tile.neighborEnd && !simulated; ++k)
+		{
+			simulated = m_tileBuffer[m_tileNeighborBuffer[k]].awake;
+		}
+
+		// A tile leaving the simulation drops what motion it had left.
+		if (tile.simulated && !simulated)
+		{
+			for (int32 k = tile.particleStart; k < tile.particleEnd; ++k)
+			{
+				m_velocityBuffer[m_tileParticleBuffer[k]].SetZero();
+			}
+		}
+		tile.simulated = simulated;
+	}
+
+	m_simulatedTileCount = 0;
+	m_liveTileCount = 0;
+	for (int32 t = 0; t < m_tileCount; ++t)
+	{
+		Tile& tile = m_tileBuffer[t];
+		bool live = tile.simulated;
+		for (int32 k = tile.neighborStart; k < tile.neighborEnd && !live; ++k)
+		{
+			live = m_tileBuffer[m_tileNeighborBuffer[k]].simulated;
+		}
+
+		// Springs that were skipped have no impulse to warm start from.
+		if (live && !tile.springsLive)
+		{
+			for (int32 i = tile.springStart; i < tile.springEnd; ++i)
+			{
+				m_springBuffer[i].impulse = 0.0f;
+			}
+		}
+		tile.springsLive = live;
+
+		if (tile.simulated)
+		{
+			m_simulatedTiles[m_simulatedTileCount++] = t;
+		}
+		if (live)
+		{
+			m_liveTiles[m_liveTileCount++] = t;
+		}
+	}
+}
+
+void b2ParticleSystem::UpdateTileSleep(const b2TimeStep& step)
+{
+	const float32 toleranceSquared = m_def.linearSleepTolerance * m_def.linearSleepTolerance;
+	const b2Vec2* v = m_velocityBuffer;
+
+	for (int32 i = 0; i < m_simulatedTileCount; ++i)
+	{
+		Tile& tile = m_tileBuffer[m_simulatedTiles[i]];
+
+		float32 speedSquared = 0.0f;
+		for (int32 k = tile.particleStart; k < tile.particleEnd; ++k)
+		{
+			int32 index = m_tileParticleBuffer[k];
+			speedSquared += b2Dot(v[index], v[index]);
+		}
+
+		int32 count = tile.particleEnd - tile.particleStart;
+		if (speedSquared >= toleranceSquared * count)
+		{
+			tile.awake = true;
+			tile.sleepTime = 0.0f;
+		}
+		else if (tile.awake)
+		{
+			tile.sleepTime += step.dt;
+			if (tile.sleepTime >= b2_timeToSleep)
+			{
+				tile.awake = false;
+			}
+		}
+	}
+}
+
+void b2ParticleSystem::InitSprings(const b2TimeStep& step)
+{
+	float32 h = step.dt;
+	b2Vec2* v = m_velocityBuffer;
+	const b2Vec2* p = m_positionBuffer;
+
+	for (int32 t = 0; t < m_liveTileCount; ++t)
+	{
+		const Tile& tile = m_tileBuffer[m_liveTiles[t]];
+		for (int32 i = tile.springStart; i < tile.springEnd; ++i)
+		{
+			Spring& s = m_springBuffer[i];
+			float32 invMassA = GetInverseMass(s.indexA);
+			float32 invMassB = GetInverseMass(s.indexB);
+			s.invMassA = invMassA;
+			s.invMassB = invMassB;
+
+			s.u = p[s.indexB] - p[s.indexA];
+			float32 length = s.u.Length();
+			if (length > b2_linearSlop)
+			{
+				s.u *= 1.0f / length;
+			}
+			else
+			{
+				s.u.SetZero();
+			}
+
+			float32 invMass = invMassA + invMassB;
+			float32 mass = invMass != 0.0f ? 1.0f / invMass : 0.0f;
+
+			float32 C = length - s.length;
+			float32 omega = 2.0f * b2_pi * s.frequencyHz;
+			float32 d = 2.0f * mass * s.dampingRatio * omega;
+			float32 k = mass * omega * omega;
+
+			s.gamma = h * (d + h * k);
+			s.gamma = s.gamma != 0.0f ? 1.0f / s.gamma : 0.0f;
+			s.bias = C * h * k * s.gamma;
+
+			invMass += s.gamma;
+			s.mass = invMass != 0.0f ? 1.0f / invMass : 0.0f;
+
+			if (step.warmStarting)
+			{
+				s.impulse *= step.dtRatio;
+
+				b2Vec2 P = s.impulse * s.u;
+				v[s.indexA] -= invMassA * P;
+				v[s.indexB] += invMassB * P;
+			}
+			else
+			{
+				s.impulse = 0.0f;
+			}
+		}
+	}
+}
+
+void b2ParticleSystem::SolveSprings()
+{
+	b2Vec2* v = m_velocityBuffer;
+
+	for (int32 t = 0; t < m_liveTileCount; ++t)
+	{
+		const Tile& tile = m_tileBuffer[m_liveTiles[t]];
+		for (int32 i = tile.springStart; i < tile.springEnd; ++i)
+		{
+			Spring& s = m_springBuffer[i];
+
+			float32 Cdot = b2Dot(s.u, v[s.indexB] - v[s.indexA]);
+			float32 impulse = -s.mass * (Cdot + s.bias + s.gamma * s.impulse);
+			s.impulse += impulse;
+
+			b2Vec2 P = impulse * s.u;
+			v[s.indexA] -= s.invMassA * P;
+			v[s.indexB] += s.invMassB * P;
+		}
+	}
+}
+
+void b2ParticleSystem::Solve(const b2TimeStep& step)
+{
+	if (m_count == 0)
+	{
+		return;
+	}
+
+	UpdateSimulatedTiles();
+	if (m_simulatedTileCount == 0)
+	{
+		// The whole system is asleep.
+		return;
+	}
+
+	float32 h = step.dt;
+	b2Vec2 gravity = m_world->GetGravity();
+	b2Vec2* p = m_positionBuffer;
+	b2Vec2* v = m_velocityBuffer;
+	const uint32* flags = m_flagsBuffer;
+
+	// Integrate velocities.
+	for (int32 t = 0; t < m_simulatedTileCount; ++t)
+	{
+		const Tile& tile = m_tileBuffer[m_simulatedTiles[t]];
+		for (int32 k = tile.particleStart; k < tile.particleEnd; ++k)
+		{
+			int32 i = m_tileParticleBuffer[k];
+			if ((flags[i] & b2_wallParticle) == 0)
+			{
+				v[i] += h * gravity;
+			}
+		}
+	}
+
+	// Solve the spring links.
+	InitSprings(step);
+	for (int32 i = 0; i < step.velocityIterations; ++i)
+	{
+		SolveSprings();
+	}
+
+	// Integrate positions, clamping the translation like b2Island does.
+	// Damping (absorbing layers, obstacles) is applied on the way,
+	// implicitly so it stays stable however strong it is.
+	const float32* damping = m_dampingBuffer;
+	for (int32 t = 0; t < m_simulatedTileCount; ++t)
+	{
+		const Tile& tile = m_tileBuffer[m_simulatedTiles[t]];
+		for (int32 k = tile.particleStart; k < tile.particleEnd; ++k)
+		{
+			int32 i = m_tileParticleBuffer[k];
+			if (flags[i] & b2_wallParticle)
+			{
+				continue;
+			}
+
+			if (damping[i] > 0.0f)
+			{
+				v[i] *= 1.0f / (1.0f + h * damping[i]);
+			}
+
+			b2Vec2 translation = h * v[i];
+			if (b2Dot(translation, translation) > b2_maxTranslationSquared)
+			{
+				float32 ratio = b2_maxTranslation / translation.Length();
+				v[i] *= ratio;
+			}
+
+			p[i] += h * v[i];
+		}
+	}
+
+	UpdateTileSleep(step);
+
+	m_gridDirty = true;
+}
+
+void b2ParticleSystem::UpdateGrid() const
+{
+	m_gridDirty = false;
+
+	b2Vec2 lower = m_positionBuffer[0];
+	b2Vec2 upper = m_positionBuffer[0];
+	for (int32 i = 1; i < m_count; ++i)
+	{
+		lower = b2Min(lower, m_positionBuffer[i]);
+		upper = b2Max(upper, m_positionBuffer[i]);
+	}
+
+	b2Vec2 extent = upper - lower;
+	float32 area = b2Max(extent.x, b2_linearSlop) * b2Max(extent.y, b2_linearSlop);
+
+	// Keep the cell count proportional to the particle count even when a few
+	// particles fly far from the rest.
+	float32 cellSize = m_def.gridCellSize;
+	float32 minCellSize = b2Sqrt(area / (4.0f * m_count));
+	if (cellSize <= 0.0f)
+	{
+		cellSize = b2Sqrt(area / m_count);
+	}
+	cellSize = b2Max(cellSize, minCellSize);
+
+	m_gridLower = lower;
+	m_gridInvCellSize = 1.0f / cellSize;
+	m_gridColumns = (int32)(extent.x * m_gridInvCellSize) + 1;
+	m_gridRows = (int32)(extent.y * m_gridInvCellSize) + 1;
+
+	int32 cellCount = m_gridColumns * m_gridRows;
+	if (cellCount + 1 > m_gridCellCapacity)
+	{
+		m_gridCellStart = b2ReallocateBuffer(m_gridCellStart, 0, cellCount + 1);
+		m_gridCellCapacity = cellCount + 1;
+	}
+
+	// Counting sort of the particles by cell.
+	memset(m_gridCellStart, 0, sizeof(int32) * (cellCount + 1));
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2Vec2 d = m_positionBuffer[i] - m_gridLower;
+		int32 column = b2Min((int32)(d.x * m_gridInvCellSize), m_gridColumns - 1);
+		int32 row = b2Min((int32)(d.y * m_gridInvCellSize), m_gridRows - 1);
+		++m_gridCellStart[row * m_gridColumns + column + 1];
+	}
+	for (int32 c = 0; c < cellCount; ++c)
+	{
+		m_gridCellStart[c + 1] += m_gridCellStart[c];
+	}
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2Vec2 d = m_positionBuffer[i] - m_gridLower;
+		int32 column = b2Min((int32)(d.x * m_gridInvCellSize), m_gridColumns - 1);
+		int32 row = b2Min((int32)(d.y * m_gridInvCellSize), m_gridRows - 1);
+		m_gridParticles[m_gridCellStart[row * m_gridColumns + column]++] = i;
+	}
+	for (int32 c = cellCount; c > 0; --c)
+	{
+		m_gridCellStart[c] = m_gridCellStart[c - 1];
+	}
+	m_gridCellStart[0] = 0;
+}
+
+void b2ParticleSystem::QueryAABB(b2QueryCallback* callback, const b2AABB& aabb) const
+{
+	if (m_count == 0)
+	{
+		return;
+	}
+
+	if (m_gridDirty)
+	{
+		UpdateGrid();
+	}
+
+	b2Vec2 lower = m_gridInvCellSize * (aabb.lowerBound - m_gridLower);
+	b2Vec2 upper = m_gridInvCellSize * (aabb.upperBound - m_gridLower);
+	if (upper.x < 0.0f || upper.y < 0.0f || lower.x >= m_gridColumns || lower.y >= m_gridRows)
+	{
+		return;
+	}
+
+	int32 firstColumn = b2Max((int32)lower.x, 0);
+	int32 firstRow = b2Max((int32)lower.y, 0);
+	int32 lastColumn = b2Min((int32)upper.x, m_gridColumns - 1);
+	int32 lastRow = b2Min((int32)upper.y, m_gridRows - 1);
+
+	for (int32 row = firstRow; row <= lastRow; ++row)
+	{
+		for (int32 column = firstColumn; column <= lastColumn; ++column)
+		{
+			int32 cell = row * m_gridColumns + column;
+			for (int32 k = m_gridCellStart[cell]; k < m_gridCellStart[cell + 1]; ++k)
+			{
+				int32 index = m_gridParticles[k];
+				const b2Vec2& p = m_positionBuffer[index];
+				if (p.x < aabb.lowerBound.x || p.y < aabb.lowerBound.y ||
+					p.x > aabb.upperBound.x || p.y > aabb.upperBound.y)
+				{
+					continue;
+				}
+
+				if (callback->ReportParticle(this, index) == false)
+				{
+					return;
+				}
+			}
+		}
+	}
+}
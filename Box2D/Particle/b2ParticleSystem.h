@@ -0,0 +1,350 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_PARTICLE_SYSTEM_H
+#define B2_PARTICLE_SYSTEM_H
+
+#include <Box2D/Common/b2Math.h>
+#include <Box2D/Dynamics/b2TimeStep.h>
+
+struct b2AABB;
+class b2World;
+class b2QueryCallback;
+class b2ParticleSystem;
+
+/// The particle flags. These can be combined.
+enum b2ParticleFlag
+{
+	/// A particle that takes part in the simulation.
+	b2_springParticle = 0,
+	/// A particle with infinite mass. It never moves but its springs still
+	/// act on the particles connected to it.
+	b2_wallParticle = 1 << 0
+};
+
+/// A particle system definition holds all the data needed to construct a
+/// particle system. The system is created through b2World::CreateParticleSystem.
+struct b2ParticleSystemDef
+{
+	b2ParticleSystemDef()
+	{
+		radius = 0.5f;
+		density = 1.0f;
+		gridCellSize = 0.0f;
+		tileSize = 8;
+		linearSleepTolerance = b2_linearSleepTolerance;
+	}
+
+	/// The particle radius, usually in meters.
+	float32 radius;
+
+	/// The particle density, usually in kg/m^2. The particle mass is the
+	/// mass of a disk with the particle radius.
+	float32 density;
+
+	/// The cell size of the uniform grid used for neighbour queries. Zero
+	/// picks a size that holds about one particle per cell.
+	float32 gridCellSize;
+
+	/// The number of lattice rows and columns in a tile. Each particle group
+	/// is split into square tiles that sleep and wake as a unit.
+	int32 tileSize;
+
+	/// A tile whose root-mean-square particle speed stays below this speed
+	/// for b2_timeToSleep falls asleep. Sleeping tiles that have no awake
+	/// neighbour are skipped by the solver.
+	float32 linearSleepTolerance;
+};
+
+/// A particle group definition describes a rectangular lattice of particles
+/// connected by spring links. The particles are laid out row by row starting
+/// at the origin.
+struct b2ParticleGroupDef
+{
+	b2ParticleGroupDef()
+	{
+		flags = b2_springParticle;
+		borderFlags = b2_springParticle;
+		origin.SetZero();
+		columnCount = 0;
+		rowCount = 0;
+		spacing = 1.0f;
+		frequencyHz = 0.0f;
+		dampingRatio = 0.0f;
+		diagonalSprings = true;
+		absorbingWidth = 0;
+		absorbingDamping = 0.0f;
+	}
+
+	/// The particle flags of the interior particles.
+	uint32 flags;
+
+	/// The particle flags of the particles on the outermost rows and columns.
+	uint32 borderFlags;
+
+	/// The world position of the first particle.
+	b2Vec2 origin;
+
+	/// The number of particles in each row and column.
+	int32 columnCount;
+	int32 rowCount;
+
+	/// The distance between neighbouring particles. This is also the rest
+	/// length of the horizontal and vertical springs.
+	float32 spacing;
+
+	/// The spring mass-spring-damper frequency in Hertz. This must be positive.
+	float32 frequencyHz;
+
+	/// The spring damping ratio. 0 = no damping, 1 = critical damping.
+	float32 dampingRatio;
+
+	/// Link every particle to its upper-left neighbour as well, which
+	/// triangulates the lattice so it resists shear.
+	bool diagonalSprings;
+
+	/// The number of rows and columns inside the border that damp the
+	/// particle velocities, so waves leave the lattice instead of reflecting
+	/// off the pinned border. 0 disables the absorbing layer.
+	int32 absorbingWidth;
+
+	/// The damping rate in 1/s next to the border. It falls off
+	/// quadratically to zero across the absorbing layer, which keeps the
+	/// reflection at the inner edge of the layer small.
+	float32 absorbingDamping;
+};
+
+/// A group of particles created together from a b2ParticleGroupDef. The
+/// particles of a group are contiguous in the particle buffers.
+class b2ParticleGroup
+{
+public:
+	/// Get the index of the first particle of this group in the particle buffers.
+	int32 GetBufferIndex() const { return m_firstIndex; }
+
+	/// Get the number of particles in this group.
+	int32 GetParticleCount() const { return m_lastIndex - m_firstIndex; }
+
+	/// Get the lattice dimensions of this group.
+	int32 GetColumnCount() const { return m_columnCount; }
+	int32 GetRowCount() const { return m_rowCount; }
+
+	/// Get the lattice origin and spacing of this group.
+	const b2Vec2& GetOrigin() const { return m_origin; }
+	float32 GetSpacing() const { return m_spacing; }
+
+	/// Get the next group in the system's group list.
+	b2ParticleGroup* GetNext() { return m_next; }
+	const b2ParticleGroup* GetNext() const { return m_next; }
+
+private:
+	friend class b2ParticleSystem;
+
+	b2ParticleGroup() {}
+
+	int32 m_firstIndex;
+	int32 m_lastIndex;
+	int32 m_columnCount;
+	int32 m_rowCount;
+	b2Vec2 m_origin;
+	float32 m_spacing;
+
+	b2ParticleGroup* m_prev;
+	b2ParticleGroup* m_next;
+};
+
+/// A particle system stores particles in flat structure-of-arrays buffers and
+/// links them with implicit spring constraints. It has no bodies, fixtures,
+/// joints or broad-phase proxies, so large lattices step at a fraction of the
+/// cost of the equivalent rigid bodies and distance joints.
+class b2ParticleSystem
+{
+public:
+	/// Create a lattice of particles and spring links.
+	/// @warning This function is locked during callbacks.
+	b2ParticleGroup* CreateParticleGroup(const b2ParticleGroupDef& def);
+
+	/// Put a group back to rest: every particle returns to its lattice
+	/// position with zero velocity, spring impulses are cleared and the
+	/// group's tiles fall asleep.
+	void ResetParticleGroup(b2ParticleGroup* group);
+
+	/// Get the group list. A NULL group indicates the end of the list.
+	b2ParticleGroup* GetParticleGroupList() { return m_groupList; }
+	const b2ParticleGroup* GetParticleGroupList() const { return m_groupList; }
+
+	/// Get the number of particles.
+	int32 GetParticleCount() const { return m_count; }
+
+	/// Get the number of spring links.
+	int32 GetSpringCount() const { return m_springCount; }
+
+	/// Get the particle radius.
+	float32 GetRadius() const { return m_def.radius; }
+
+	/// Get the mass of a single non-wall particle.
+	float32 GetParticleMass() const { return m_particleMass; }
+
+	/// Get the number of tiles and the number of awake tiles.
+	int32 GetTileCount() const { return m_tileCount; }
+	int32 GetAwakeTileCount() const;
+
+	/// Wake the tiles holding a range of particles. Call this after writing
+	/// velocities into the velocity buffer, otherwise particles in sleeping
+	/// tiles keep their velocity without moving.
+	/// @param index the first particle of the range.
+	/// @param count the number of particles in the range.
+	void WakeParticles(int32 index, int32 count);
+
+	/// Get the particle buffers. The buffers are indexed by particle and are
+	/// valid until the next particle group is created.
+	b2Vec2* GetPositionBuffer() { return m_positionBuffer; }
+	const b2Vec2* GetPositionBuffer() const { return m_positionBuffer; }
+	b2Vec2* GetVelocityBuffer() { return m_velocityBuffer; }
+	const b2Vec2* GetVelocityBuffer() const { return m_velocityBuffer; }
+	const uint32* GetFlagsBuffer() const { return m_flagsBuffer; }
+
+	/// Get the velocity damping rate of every particle, in 1/s. It starts
+	/// out as the absorbing layer of the particle's group.
+	const float32* GetDampingBuffer() const { return m_dampingBuffer; }
+
+	/// Set the velocity damping rates of a range of particles, in 1/s. This
+	/// replaces the absorbing layer rates of those particles.
+	/// @param index the first particle of the range.
+	/// @param count the number of particles in the range.
+	/// @param damping one rate per particle of the range.
+	void SetParticleDamping(int32 index, int32 count, const float32* damping);
+
+	/// Query the particle system for all particles inside the provided AABB.
+	/// The query uses the system's uniform grid, not the world broad-phase.
+	/// @param callback receives b2QueryCallback::ReportParticle calls.
+	/// @param aabb the query box.
+	void QueryAABB(b2QueryCallback* callback, const b2AABB& aabb) const;
+
+	/// Get the next particle system in the world's list.
+	b2ParticleSystem* GetNext() { return m_next; }
+	const b2ParticleSystem* GetNext() const { return m_next; }
+
+private:
+	friend class b2World;
+
+	/// A spring link between two particles. The solver data mirrors the
+	/// soft constraint of b2DistanceJoint.
+	struct Spring
+	{
+		int32 indexA;
+		int32 indexB;
+		float32 length;
+		float32 frequencyHz;
+		float32 dampingRatio;
+
+		// Solver temp
+		b2Vec2 u;
+		float32 invMassA;
+		float32 invMassB;
+		float32 mass;
+		float32 gamma;
+		float32 bias;
+		float32 impulse;
+	};
+
+	/// A square block of lattice particles that sleeps as a unit. Its
+	/// particles and the springs ending in it are contiguous in the tile
+	/// particle buffer and the spring buffer.
+	struct Tile
+	{
+		int32 particleStart;
+		int32 particleEnd;
+		int32 springStart;
+		int32 springEnd;
+		int32 neighborStart;
+		int32 neighborEnd;
+		float32 sleepTime;
+		bool awake;
+
+		// Solver temp
+		bool simulated;
+		bool springsLive;
+	};
+
+	b2ParticleSystem(const b2ParticleSystemDef* def, b2World* world);
+	~b2ParticleSystem();
+
+	void Solve(const b2TimeStep& step);
+
+	void ReallocateParticles(int32 capacity);
+	void ReallocateSprings(int32 capacity);
+	void AddSpring(int32 indexA, int32 indexB, float32 length, const b2ParticleGroupDef& def);
+	void CreateTiles(int32 firstIndex, int32 firstSpring, const b2ParticleGroupDef& def);
+	float32 GetInverseMass(int32 index) const;
+
+	void UpdateSimulatedTiles();
+	void UpdateTileSleep(const b2TimeStep& step);
+	void InitSprings(const b2TimeStep& step);
+	void SolveSprings();
+	void UpdateGrid() const;
+
+	b2ParticleSystemDef m_def;
+	b2World* m_world;
+	float32 m_particleMass;
+	float32 m_particleInvMass;
+
+	int32 m_count;
+	int32 m_capacity;
+	b2Vec2* m_positionBuffer;
+	b2Vec2* m_velocityBuffer;
+	uint32* m_flagsBuffer;
+	float32* m_dampingBuffer;
+
+	int32 m_springCount;
+	int32 m_springCapacity;
+	Spring* m_springBuffer;
+
+	// Tiles, the tile of every particle and the particles of every tile.
+	// Each step the solver visits only the simulated tiles (awake tiles and
+	// their neighbours) and the live tiles (simulated tiles and their
+	// neighbours, whose springs reach into the simulated ones).
+	int32 m_tileCount;
+	Tile* m_tileBuffer;
+	int32* m_particleTileBuffer;
+	int32* m_tileParticleBuffer;
+	int32 m_tileNeighborCount;
+	int32* m_tileNeighborBuffer;
+	int32 m_simulatedTileCount;
+	int32* m_simulatedTiles;
+	int32 m_liveTileCount;
+	int32* m_liveTiles;
+
+	// Uniform grid over the current particle positions. It is rebuilt lazily
+	// by the first query after the particles have moved.
+	mutable bool m_gridDirty;
+	mutable b2Vec2 m_gridLower;
+	mutable float32 m_gridInvCellSize;
+	mutable int32 m_gridColumns;
+	mutable int32 m_gridRows;
+	mutable int32 m_gridCellCapacity;
+	mutable int32* m_gridCellStart;
+	mutable int32* m_gridParticles;
+
+	b2ParticleGroup* m_groupList;
+
+	b2ParticleSystem* m_prev;
+	b2ParticleSystem* m_next;
+};
+
+#endif
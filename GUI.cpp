@@ -9,6 +9,7 @@
 #include "ui_GUI.h"
 #include "environment.h"
 #include "gamemenupage.h"
+#include <algorithm>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent), ui(new Ui::MainWindow)
@@ -33,6 +34,12 @@ MainWindow::MainWindow(QWidget *parent)
 
     levelInstructionWindow = new LevelInstructionPage(this);
 
+    // The level world is drawn on one widget for the whole session; levels
+    // only clear it.
+    level = new Environment(this);
+    level->spriteSheet = sprites.pixmap();
+    stackedWidget->addWidget(level);
+
     // signals/slots for secondary gui windows
     connect(levelInstructionWindow, &LevelInstructionPage::continueButtonClicked, this, &MainWindow::dismissInstructions);
     connect(gameMenuWindow, &GameMenuPage::levelSelected, this, &MainWindow::dismissInstructions);
@@ -94,6 +101,34 @@ void MainWindow::createControlPanel(){
         emit transmitButtonClicked();
     });
 
+    QVBoxLayout* transmitLayout = new QVBoxLayout();
+    QCheckBox* continuousWaveBox = new QCheckBox("Continuous Wave", this);
+    continuousWaveBox->setStyleSheet("color: white;");
+    connect(continuousWaveBox, &QCheckBox::toggled, this, [=](bool checked)
+    {
+        emit continuousWaveToggled(checked);
+    });
+    QCheckBox* coverageBox = new QCheckBox("Coverage", this);
+    coverageBox->setStyleSheet("color: white;");
+    connect(coverageBox, &QCheckBox::toggled, this, [=](bool checked)
+    {
+        if (!checked) {
+            coverageImage = QImage();
+            level -> drawCoverage(coverageImage, coverageRect);
+        }
+        emit coverageToggled(checked);
+    });
+    QCheckBox* amplitudeBox = new QCheckBox("Amplitude", this);
+    amplitudeBox->setStyleSheet("color: white;");
+    connect(amplitudeBox, &QCheckBox::toggled, this, [=](bool checked)
+    {
+        level -> setWaveView(checked ? Environment::WaveView::Amplitude : Environment::WaveView::Particles);
+    });
+    transmitLayout->addWidget(transmitButton);
+    transmitLayout->addWidget(continuousWaveBox);
+    transmitLayout->addWidget(coverageBox);
+    transmitLayout->addWidget(amplitudeBox);
+
     QVBoxLayout* powerLayout = new QVBoxLayout();
     QLabel* powerLabel = new QLabel("Transmit Power");
     powerLabel->setAlignment(Qt::AlignHCenter);
@@ -169,6 +204,19 @@ void MainWindow::createControlPanel(){
     freqBandLayout->addWidget(freqBandLabel);
     freqBandLayout->addWidget(frequencyBandSelector);
 
+    QVBoxLayout* propagationLayout = new QVBoxLayout();
+    QLabel* propagationLabel = new QLabel("Propagation");
+    propagationLabel->setAlignment(Qt::AlignCenter);
+    QComboBox* propagationSelector = new QComboBox(this);
+    propagationSelector->addItems({"mesh", "grid"});
+    connect(propagationSelector, &QComboBox::currentIndexChanged, this, [=](int index)
+    {
+        QString selectedPropagationMode = propagationSelector->itemText(index);
+        emit propagationModeSelected(selectedPropagationMode);
+    });
+    propagationLayout->addWidget(propagationLabel);
+    propagationLayout->addWidget(propagationSelector);
+
     QVBoxLayout* btnLayout = new QVBoxLayout();
     QPushButton* instructionBtn = new QPushButton("INSTRUCTIONS", this);
     instructionBtn->setStyleSheet(
@@ -222,7 +270,8 @@ void MainWindow::createControlPanel(){
     layout->addLayout(powerLayout);
     layout->addLayout(heightLayout);
     layout->addLayout(orientationLayout);
-    layout->addWidget(transmitButton);
+    layout->addLayout(propagationLayout);
+    layout->addLayout(transmitLayout);
     layout->addSpacerItem(new QSpacerItem(50, 20, QSizePolicy::Minimum, QSizePolicy::Expanding));
     layout->addLayout(btnLayout);
     panelContainer->setLayout(layout);
@@ -266,7 +315,8 @@ void MainWindow::displayGameMenu()
 
 void MainWindow::setupLevel(int levelNumber)
 {
-    level = new Environment(this);
+    level->clearLevel();
+    stackedWidget->setCurrentWidget(level);
     displayInstructionWindow(levelNumber);
 }
 
@@ -294,58 +344,47 @@ void MainWindow::dismissInstructions()
     qDebug() << "dismissing instruction window" << Qt::endl;
 }
 
-void MainWindow::displayLevel(QVector<b2Vec2> position)
+void MainWindow::displayLevel(const std::vector<b2Vec2>& previous, const std::vector<b2Vec2>& position, float alpha)
 {
-    level = new Environment(this);
-    level -> drawParticles(position);
+    level -> drawParticles(previous, position, alpha);
 }
 
-void MainWindow::displayLevelObjects(QVector<ObjectData> objects){
-    level->drawQueue.clear();
-    stackedWidget->addWidget(level);
-    stackedWidget->setCurrentWidget(level);
-    for(ObjectData &obj : objects) {
-         switch (obj.type) {
-         case ObjectType::Rock:{
-             QPixmap rockImg = QPixmap(":/img/rock.png");
-
-             rockImg = rockImg.scaled(rockImg.width() * 0.1f,
-                                      rockImg.height()* 0.1f,
-                                      Qt::KeepAspectRatio,
-                                      Qt::SmoothTransformation);
-             level -> drawObjects(obj.objPos, rockImg);
-             break;
-         }
-         case ObjectType::Tree:{
-             QPixmap treeImg = QPixmap(":/img/tree.png");
-             treeImg = treeImg.scaled(treeImg.width() * 0.15f,
-                                      treeImg.height()* 0.15f,
-                                      Qt::KeepAspectRatio,
-                                      Qt::SmoothTransformation);
-                level -> drawObjects(obj.objPos, treeImg);
-             break;
-         }
-         case ObjectType::Hill:{
-             QPixmap hillImg = QPixmap(":/img/hills.png");
-             hillImg = hillImg.scaled(hillImg.width() * 0.4f,
-                                      hillImg.height()* 0.4f,
-                                      Qt::KeepAspectRatio,
-                                      Qt::SmoothTransformation);
-             level -> drawObjects(obj.objPos, hillImg);
-             break;
-         }
-         case ObjectType::Human:{
-             QPixmap humanImg = QPixmap(":/img/human.png");
-             humanImg = humanImg.scaled(humanImg.width() * 0.15f,
-                                      humanImg.height()* 0.15f,
-                                      Qt::KeepAspectRatio,
-                                      Qt::SmoothTransformation);
-             level -> drawObjects(obj.objPos, humanImg);
-             break;
-         }
+void MainWindow::displayCoverage(const CoverageMap& coverage)
+{
+    // Received power mapped from blue at the receiver sensitivity to red
+    // near the antenna.
+    const float sensitivity = -100.0f;
+    const float strongest = -30.0f;
+
+    if (coverageImage.width() != coverage.columns() || coverageImage.height() != coverage.rows()) {
+        coverageImage = QImage(coverage.columns(), coverage.rows(), QImage::Format_ARGB32);
+    }
+
+    const std::vector<float>& power = coverage.receivedPower();
+    for (int row = 0; row < coverage.rows(); ++row) {
+        QRgb* line = reinterpret_cast<QRgb*>(coverageImage.scanLine(row));
+        for (int column = 0; column < coverage.columns(); ++column) {
+            float dbm = power[size_t(row) * coverage.columns() + column];
+            if (dbm < sensitivity) {
+                line[column] = qRgba(0, 0, 0, 0);
+                continue;
+            }
+            float strength = std::min(1.0f, (dbm - sensitivity) / (strongest - sensitivity));
+            line[column] = QColor::fromHsvF(0.66f * (1.0f - strength), 1.0f, 1.0f, 0.45f).rgba();
         }
-     }
+    }
+
+    coverageRect = QRectF(coverage.lower().x, coverage.lower().y,
+                          coverage.columns() * coverage.cellSize(),
+                          coverage.rows() * coverage.cellSize());
+    level -> drawCoverage(coverageImage, coverageRect);
+}
 
+void MainWindow::displayLevelObjects(QVector<ObjectData> objects){
+    level->clearObjects();
+    for(ObjectData &obj : objects) {
+        level -> drawObjects(obj.objPos, sprites.sprite(obj.type));
+    }
 }
 
 void MainWindow::displayLevelCompleteWindow(int currentLevel)
@@ -391,6 +430,12 @@ void MainWindow::resetScore()
     qDebug() << "Score reset.";
 }
 
+void MainWindow::setParticleQuality(Environment::ParticleQuality quality)
+{
+    level->setParticleQuality(quality);
+}
 
-
-
+void MainWindow::setWaveLattice(const LatticeIndex& lattice)
+{
+    level->setLattice(lattice);
+}
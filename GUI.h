@@ -18,7 +18,9 @@
 #include <QPushButton>
 #include <QSlider>
 #include <QComboBox>
+#include <QCheckBox>
 #include <QDial>
+#include <QImage>
 #include <QDebug>
 
 #include "environment.h"
@@ -27,6 +29,7 @@
 #include "levelcompletepage.h"
 #include "gamemenupage.h"
 #include "model.h"
+#include "spriteatlas.h"
 //#include "levelworldpage.h"
 
 QT_BEGIN_NAMESPACE
@@ -78,15 +81,24 @@ public:
     * Additionally, on the control panel is a button to send a radio transmission and
     * a button to return the player to the main game menu.
     */
-    void displayLevel(QVector<b2Vec2> position);
+    void displayLevel(const std::vector<b2Vec2>& previous, const std::vector<b2Vec2>& position, float alpha);
 
 
     /**
-     * @brief Displays objects based on level selected by user.
+     * @brief Displays objects based on level selected by user. The model only
+     * sends them when the level layout changes.
      * @param vector of different objects
      */
     void displayLevelObjects(QVector<ObjectData> objects);
 
+    /**
+     * @brief Turns the coverage map into a heatmap image drawn under the level.
+     * Cells below the receiver sensitivity are left transparent.
+     *
+     * @param coverage - received power over the level
+     */
+    void displayCoverage(const CoverageMap& coverage);
+
     /**
     * @brief Redraws the level objects according to the new positions recieved from model.
     *
@@ -116,6 +128,21 @@ public:
     void updateScore(int points);
     void resetScore();
 
+    /**
+     * @brief Chooses between fast and antialiased particle rendering.
+     *
+     * @param quality - rendering quality of the level's particles
+     */
+    void setParticleQuality(Environment::ParticleQuality quality);
+
+    /**
+     * @brief Gives the view the layout of the particle mesh, which the
+     * amplitude view needs to find how far each particle is displaced.
+     *
+     * @param lattice - lattice of the model's particle mesh
+     */
+    void setWaveLattice(const LatticeIndex& lattice);
+
 private:
     Ui::MainWindow *ui;
     Environment* level;
@@ -124,6 +151,9 @@ private:
     LevelInstructionPage* levelInstructionWindow;
     LevelCompletePage* levelCompleteWindow;
     QDockWidget* controlPanel = nullptr;
+    QImage coverageImage;  // Heatmap of the coverage map, one pixel per cell
+    QRectF coverageRect;  // Area of the level covered by the heatmap
+    SpriteAtlas sprites;  // Object images, scaled once
     //LevelWorldPage* levelWorldWindow;
     int score = 0; // Game score
 
@@ -135,11 +165,14 @@ signals:
     void gameMenuButtonClicked();
     void instructionButtonClicked();
     void transmitButtonClicked();
+    void continuousWaveToggled(bool enabled);
+    void coverageToggled(bool visible);
     void frequencyBandSelected(const QString& selectedFrequencyBand);
     void antennaTypeSelected(const QString& selectedAntennaType);
     void powerLevelAdjusted(int selectedPowerLevel);
     void antennaHeightAdjusted(int selectedAntennaHeight);
     void antennaOrientationAdjusted(int selectedAntennaOrientation);
+    void propagationModeSelected(const QString& selectedPropagationMode);
 
     void levelComplete(int score);
 
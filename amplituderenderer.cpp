@@ -0,0 +1,196 @@
+/**
+ * This class is the amplitude heatmap renderer.
+ *
+ * It turns how far the mesh nodes are displaced into
+ * colours, interpolating between the nodes so that
+ * the wave fronts read as smooth bands.
+ */
+
+#include "amplituderenderer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+// Colour ramp stops: position along the ramp, then red, green, blue and
+// opacity. Small displacements stay see-through so the level shows under them.
+struct RampStop
+{
+    float position;
+    float red;
+    float green;
+    float blue;
+    float alpha;
+};
+
+const RampStop rampStops[] = {
+    {0.0f, 0.0f, 0.0f, 0.0f, 0.0f},
+    {0.25f, 0.0f, 0.2f, 1.0f, 0.5f},
+    {0.5f, 0.0f, 1.0f, 1.0f, 0.7f},
+    {0.75f, 1.0f, 1.0f, 0.0f, 0.8f},
+    {1.0f, 1.0f, 0.0f, 0.0f, 0.85f},
+};
+
+const float topLevel = 255.0f;  // Ramp position of the last colour
+}
+
+AmplitudeRenderer::AmplitudeRenderer()
+{
+    const int stopCount = int(sizeof(rampStops) / sizeof(rampStops[0]));
+    for (int i = 0; i < 256; ++i) {
+        float position = i / topLevel;
+        int stop = 1;
+        while (stop < stopCount - 1 && rampStops[stop].position < position) {
+            ++stop;
+        }
+        const RampStop& low = rampStops[stop - 1];
+        const RampStop& high = rampStops[stop];
+        float t = (position - low.position) / (high.position - low.position);
+
+        float alpha = low.alpha + t * (high.alpha - low.alpha);
+        uint32_t a = uint32_t(std::lround(255.0f * alpha));
+        uint32_t r = uint32_t(std::lround(255.0f * alpha * (low.red + t * (high.red - low.red))));
+        uint32_t g = uint32_t(std::lround(255.0f * alpha * (low.green + t * (high.green - low.green))));
+        uint32_t b = uint32_t(std::lround(255.0f * alpha * (low.blue + t * (high.blue - low.blue))));
+        m_ramp[i] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+}
+
+void AmplitudeRenderer::setLattice(const LatticeIndex& lattice)
+{
+    // Bilinear upsampling needs two nodes in each direction.
+    bool usable = lattice.columns() >= 2 && lattice.rows() >= 2;
+    m_origin = usable ? lattice.position(0) : b2Vec2(0.0f, 0.0f);
+    m_spacing = lattice.spacing();
+    m_columns = usable ? lattice.columns() : 0;
+    m_rows = usable ? lattice.rows() : 0;
+    m_preparedWidth = -1;
+}
+
+void AmplitudeRenderer::setFullScale(float displacement)
+{
+    m_fullScale = std::max(displacement, 1e-3f);
+}
+
+void AmplitudeRenderer::prepareColumns(int width)
+{
+    m_columnNodes.resize(size_t(width));
+    m_columnWeights.resize(size_t(width));
+    for (int x = 0; x < width; ++x) {
+        float column = std::min(std::max((x - m_origin.x) / m_spacing, 0.0f), float(m_columns - 1));
+        int node = std::min(int(column), m_columns - 2);
+        m_columnNodes[size_t(x)] = node;
+        m_columnWeights[size_t(x)] = column - node;
+    }
+    m_preparedWidth = width;
+}
+
+void AmplitudeRenderer::render(const std::vector<b2Vec2>& previous, const std::vector<b2Vec2>& positions, float alpha,
+                               uint32_t* pixels, int width, int height, int stride)
+{
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    size_t nodeCount = size_t(m_columns) * size_t(m_rows);
+    if (!hasLattice() || positions.size() < nodeCount || previous.size() < nodeCount) {
+        for (int y = 0; y < height; ++y) {
+            std::fill(pixels + size_t(y) * stride, pixels + size_t(y) * stride + width, m_ramp[0]);
+        }
+        return;
+    }
+    if (width != m_preparedWidth) {
+        prepareColumns(width);
+    }
+
+    // Lattice rows the pixel rows fall between.
+    auto rowOf = [this](int y) {
+        return std::min(std::max((y - m_origin.y) / m_spacing, 0.0f), float(m_rows - 1));
+    };
+    int firstRow = std::min(int(rowOf(0)), m_rows - 2);
+    int lastRow = std::min(int(rowOf(height - 1)), m_rows - 2) + 1;
+
+    // Ramp position at every node of those rows. There are far fewer nodes
+    // than pixels, so this stays scalar.
+    m_levels.resize(nodeCount);
+    const float levelScale = topLevel / m_fullScale;
+    for (int row = firstRow; row <= lastRow; ++row) {
+        float restY = m_origin.y + row * m_spacing;
+        for (int column = 0; column < m_columns; ++column) {
+            size_t node = size_t(row) * m_columns + column;
+            b2Vec2 position = previous[node] + alpha * (positions[node] - previous[node]);
+            float dx = position.x - (m_origin.x + column * m_spacing);
+            float dy = position.y - restY;
+            m_levels[node] = std::min(std::sqrt(dx * dx + dy * dy) * levelScale, topLevel);
+        }
+    }
+
+    // Upsample along the lattice rows to one value per pixel column.
+    m_expanded.resize(size_t(m_rows) * width);
+    for (int row = firstRow; row <= lastRow; ++row) {
+        const float* levels = m_levels.data() + size_t(row) * m_columns;
+        float* expanded = m_expanded.data() + size_t(row) * width;
+        for (int x = 0; x < width; ++x) {
+            int node = m_columnNodes[size_t(x)];
+            expanded[x] = levels[node] + m_columnWeights[size_t(x)] * (levels[node + 1] - levels[node]);
+        }
+    }
+
+    // Blend the two lattice rows around every pixel row and look the result
+    // up in the ramp.
+    for (int y = 0; y < height; ++y) {
+        float rowPosition = rowOf(y);
+        int row = std::min(int(rowPosition), m_rows - 2);
+        float weight = rowPosition - row;
+        const float* upper = m_expanded.data() + size_t(row) * width;
+        const float* lower = upper + width;
+        uint32_t* line = pixels + size_t(y) * stride;
+
+        int x = 0;
+#if defined(__AVX__)
+        const __m256 vweight = _mm256_set1_ps(weight);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 top = _mm256_set1_ps(topLevel);
+        for (; x + 8 <= width; x += 8) {
+            __m256 a = _mm256_loadu_ps(upper + x);
+            __m256 value = _mm256_add_ps(a, _mm256_mul_ps(vweight, _mm256_sub_ps(_mm256_loadu_ps(lower + x), a)));
+            __m256i index = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(value, zero), top));
+#if defined(__AVX2__)
+            __m256i colours = _mm256_i32gather_epi32(reinterpret_cast<const int*>(m_ramp), index, 4);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(line + x), colours);
+#else
+            alignas(32) int32_t lanes[8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), index);
+            for (int lane = 0; lane < 8; ++lane) {
+                line[x + lane] = m_ramp[lanes[lane]];
+            }
+#endif
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        const __m128 vweight = _mm_set1_ps(weight);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 top = _mm_set1_ps(topLevel);
+        for (; x + 4 <= width; x += 4) {
+            __m128 a = _mm_loadu_ps(upper + x);
+            __m128 value = _mm_add_ps(a, _mm_mul_ps(vweight, _mm_sub_ps(_mm_loadu_ps(lower + x), a)));
+            __m128i index = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(value, zero), top));
+            alignas(16) int32_t lanes[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), index);
+            line[x] = m_ramp[lanes[0]];
+            line[x + 1] = m_ramp[lanes[1]];
+            line[x + 2] = m_ramp[lanes[2]];
+            line[x + 3] = m_ramp[lanes[3]];
+        }
+#endif
+        for (; x < width; ++x) {
+            float value = upper[x] + weight * (lower[x] - upper[x]);
+            line[x] = m_ramp[int(std::min(std::max(value, 0.0f), topLevel))];
+        }
+    }
+}
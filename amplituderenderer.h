@@ -0,0 +1,71 @@
+/**
+ * @file AmplitudeRenderer.h
+ * @brief This class paints the wave as a heatmap of how far every node of the
+ * particle mesh is displaced from its rest position, instead of as the displaced
+ * dots themselves. The displacement magnitudes are scaled to the entries of a
+ * 256-colour ramp at the lattice nodes, upsampled bilinearly to the pixels in two
+ * separable passes, and looked up in the ramp straight into an ARGB32 buffer.
+ * The per-pixel pass, a vertical blend of two upsampled lattice rows and the
+ * ramp lookup, is vectorised with SSE2 or AVX when the compiler targets them.
+ *
+ * @author: Trentton Stratton, Phuc Hoang, Chanphone Visathip, Thu Ha.
+ * @date: 12/12/2024
+ */
+
+#ifndef AMPLITUDERENDERER_H
+#define AMPLITUDERENDERER_H
+
+#include <cstdint>
+#include <vector>
+#include "Box2D/Box2D.h"
+#include "latticeindex.h"
+
+// The AmplitudeRenderer class colours displacement magnitudes into a pixel buffer.
+class AmplitudeRenderer
+{
+public:
+    AmplitudeRenderer();
+
+    // Uses the lattice of the particle mesh the frames come from. The
+    // positions passed to render() are in the lattice's node order.
+    void setLattice(const LatticeIndex& lattice);
+    bool hasLattice() const { return m_columns > 0 && m_rows > 0; }
+
+    // Displacement shown with the last colour of the ramp; larger ones are
+    // clamped to it.
+    void setFullScale(float displacement);
+    float fullScale() const { return m_fullScale; }
+
+    /**
+     * Paints the displacement of a frame blended between two steps. Pixel
+     * coordinates are world coordinates, as for the particles.
+     * @param previous Node positions one simulation step earlier.
+     * @param positions Latest node positions.
+     * @param alpha Blend factor, 0 for the previous positions and 1 for the latest.
+     * @param pixels Premultiplied ARGB32 pixels, row by row.
+     * @param width Width of the buffer in pixels.
+     * @param height Height of the buffer in pixels.
+     * @param stride Distance between two rows in pixels.
+     */
+    void render(const std::vector<b2Vec2>& previous, const std::vector<b2Vec2>& positions, float alpha,
+                uint32_t* pixels, int width, int height, int stride);
+
+private:
+    // Maps the pixel columns of a buffer width to lattice columns and weights.
+    void prepareColumns(int width);
+
+    b2Vec2 m_origin = b2Vec2(0.0f, 0.0f);
+    float m_spacing = 1.0f;
+    int m_columns = 0;
+    int m_rows = 0;
+    float m_fullScale = 24.0f;
+
+    uint32_t m_ramp[256];  // Premultiplied colours, transparent for no displacement
+    std::vector<float> m_levels;  // Ramp position of every node
+    std::vector<float> m_expanded;  // m_levels upsampled along the rows, one pixel row per lattice row
+    int m_preparedWidth = -1;  // Width m_columnNodes and m_columnWeights were made for
+    std::vector<int> m_columnNodes;  // Lattice column left of every pixel column
+    std::vector<float> m_columnWeights;  // Weight of the lattice column to its right
+};
+
+#endif // AMPLITUDERENDERER_H
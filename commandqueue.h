@@ -0,0 +1,68 @@
+/**
+ * @file CommandQueue.h
+ * @brief This class carries commands from one producer thread to one consumer
+ * thread without locks. It is a fixed ring of preallocated slots with a head
+ * index owned by the consumer and a tail index owned by the producer; each side
+ * only reads the other's index, so pushing and popping never block and never
+ * allocate beyond what copying a command into its slot does.
+ *
+ * @author: Trentton Stratton, Phuc Hoang, Chanphone Visathip, Thu Ha.
+ * @date: 12/12/2024
+ */
+
+#ifndef COMMANDQUEUE_H
+#define COMMANDQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// The CommandQueue class is a bounded single-producer, single-consumer queue.
+// It holds up to Capacity - 1 commands; Capacity must be a power of two.
+template <typename T, size_t Capacity>
+class CommandQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    CommandQueue() = default;
+
+    CommandQueue(const CommandQueue&) = delete;
+    CommandQueue& operator=(const CommandQueue&) = delete;
+
+    // Producer side. Returns false, leaving the queue unchanged, when it is full.
+    bool push(const T& command)
+    {
+        size_t last = tail.load(std::memory_order_relaxed);
+        size_t next = (last + 1) & mask;
+        if (next == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        entries[last] = command;
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false when the queue is empty.
+    bool pop(T& command)
+    {
+        size_t first = head.load(std::memory_order_relaxed);
+        if (first == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        command = std::move(entries[first]);
+        head.store((first + 1) & mask, std::memory_order_release);
+        return true;
+    }
+
+private:
+    static const size_t mask = Capacity - 1;
+
+    T entries[Capacity];
+    // The indices sit on their own cache lines so the two threads do not
+    // invalidate each other's line on every operation.
+    alignas(64) std::atomic<size_t> head{0};  // Next slot to pop, owned by the consumer
+    alignas(64) std::atomic<size_t> tail{0};  // Next slot to push, owned by the producer
+};
+
+#endif // COMMANDQUEUE_H
@@ -0,0 +1,184 @@
+/**
+ * This class is the coverage engine.
+ *
+ * It predicts the received power over the level with a
+ * link budget: transmit power plus antenna gain minus
+ * free-space path loss and the loss through every obstacle
+ * on the line of sight. Each term lives in its own cached
+ * layer so that a control change only recomputes what it
+ * affects.
+ */
+
+#include "coveragemap.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// Kilometers represented by one pixel of the level.
+const float kilometersPerPixel = 0.01f;
+
+// Deepest null of the antenna pattern, in dB.
+const float maxPatternLoss = 25.0f;
+}
+
+CoverageMap::CoverageMap(b2Vec2 lower, b2Vec2 upper, float cellSize)
+    : m_lower(lower), m_cellSize(cellSize)
+{
+    m_columns = std::max(1, int(std::ceil((upper.x - lower.x) / cellSize)));
+    m_rows = std::max(1, int(std::ceil((upper.y - lower.y) / cellSize)));
+
+    size_t cellCount = size_t(m_columns) * m_rows;
+    m_distance.resize(cellCount);
+    m_bearing.resize(cellCount);
+    m_obstacleLoss.resize(cellCount);
+    m_pathLoss.resize(cellCount);
+    m_gain.resize(cellCount);
+    m_received.resize(cellCount);
+}
+
+float CoverageMap::bandFrequency(const std::string& band)
+{
+    if (band == "VHF") {
+        return 100.0f;
+    } else if (band == "UHF") {
+        return 1000.0f;
+    } else if (band == "SHF") {
+        return 10000.0f;
+    }
+    return 10.0f;  // HF, also the default band
+}
+
+void CoverageMap::setObstacles(const b2World* world, const std::vector<std::pair<const b2Body*, float>>& losses)
+{
+    m_world = world;
+    m_obstacleLosses = losses;
+    m_geometryValid = false;
+}
+
+bool CoverageMap::update(const Settings& settings)
+{
+    // Work out which layers are stale, from the most expensive down.
+    if (!m_geometryValid || !(settings.transmitLocation == m_settings.transmitLocation)) {
+        m_geometryValid = false;
+    }
+    if (!m_geometryValid || settings.frequencyBand != m_settings.frequencyBand) {
+        m_pathLossValid = false;
+    }
+    if (!m_geometryValid || settings.beamWidth != m_settings.beamWidth ||
+        !(settings.transmitDirection == m_settings.transmitDirection)) {
+        m_gainValid = false;
+    }
+    if (!m_pathLossValid || !m_gainValid || settings.transmitPower != m_settings.transmitPower) {
+        m_receivedValid = false;
+    }
+    if (m_receivedValid) {
+        return false;
+    }
+
+    m_settings = settings;
+    if (!m_geometryValid) {
+        updateGeometry();
+    }
+    if (!m_pathLossValid) {
+        updatePathLoss();
+    }
+    if (!m_gainValid) {
+        updateGain();
+    }
+    updateReceived();
+    return true;
+}
+
+float32 CoverageMap::LossCallback::ReportFixture(b2Fixture* fixture, const b2Vec2&, const b2Vec2&, float32)
+{
+    const b2Body* body = fixture->GetBody();
+    for (const std::pair<const b2Body*, float>& obstacle : *losses) {
+        if (obstacle.first == body) {
+            loss += obstacle.second;
+            break;
+        }
+    }
+    return 1.0f;  // Keep going through every obstacle on the ray.
+}
+
+void CoverageMap::updateGeometry()
+{
+    const b2Vec2 antenna = m_settings.transmitLocation;
+
+    LossCallback callback;
+    callback.losses = &m_obstacleLosses;
+
+    for (int row = 0; row < m_rows; ++row) {
+        for (int column = 0; column < m_columns; ++column) {
+            size_t cell = size_t(row) * m_columns + column;
+            b2Vec2 center(m_lower.x + (column + 0.5f) * m_cellSize, m_lower.y + (row + 0.5f) * m_cellSize);
+            b2Vec2 offset = center - antenna;
+            float distance = offset.Length();
+
+            m_distance[cell] = std::max(distance, 0.5f * m_cellSize);
+            m_bearing[cell] = distance > b2_epsilon ? (1.0f / distance) * offset : b2Vec2(0.0f, 0.0f);
+
+            callback.loss = 0.0f;
+            if (m_world && distance > b2_linearSlop && !m_obstacleLosses.empty()) {
+                m_world->RayCast(&callback, antenna, center);
+            }
+            m_obstacleLoss[cell] = callback.loss;
+        }
+    }
+
+    m_geometryValid = true;
+}
+
+void CoverageMap::updatePathLoss()
+{
+    // Free-space path loss in dB for a distance in km and a frequency in MHz,
+    // plus obstacle losses that grow with frequency.
+    float frequency = bandFrequency(m_settings.frequencyBand);
+    float frequencyTerm = 20.0f * std::log10(frequency) + 32.44f;
+    float obstacleScale = std::max(0.25f, 1.0f + 0.5f * std::log10(frequency / 100.0f));
+
+    for (size_t cell = 0; cell < m_pathLoss.size(); ++cell) {
+        m_pathLoss[cell] = 20.0f * std::log10(m_distance[cell] * kilometersPerPixel) + frequencyTerm
+                           + obstacleScale * m_obstacleLoss[cell];
+    }
+
+    m_pathLossValid = true;
+}
+
+void CoverageMap::updateGain()
+{
+    float beamWidth = m_settings.beamWidth;
+    if (beamWidth >= 360.0f || beamWidth <= 0.0f) {
+        std::fill(m_gain.begin(), m_gain.end(), 0.0f);
+        m_gainValid = true;
+        return;
+    }
+
+    // Parabolic main lobe whose half-power width is the beam width, with
+    // the peak gain of an ideal sector of that width.
+    float peakGain = 10.0f * std::log10(360.0f / beamWidth);
+    b2Vec2 direction = m_settings.transmitDirection;
+
+    for (size_t cell = 0; cell < m_gain.size(); ++cell) {
+        float angleCos = std::max(-1.0f, std::min(1.0f, b2Dot(direction, m_bearing[cell])));
+        float angle = std::acos(angleCos) * (180.0f / b2_pi);
+        float ratio = angle / beamWidth;
+        m_gain[cell] = peakGain - std::min(12.0f * ratio * ratio, maxPatternLoss);
+    }
+
+    m_gainValid = true;
+}
+
+void CoverageMap::updateReceived()
+{
+    float transmitDbm = 30.0f + 10.0f * std::log10(float(std::max(1, m_settings.transmitPower)));
+
+    for (size_t cell = 0; cell < m_received.size(); ++cell) {
+        m_received[cell] = transmitDbm + m_gain[cell] - m_pathLoss[cell];
+    }
+
+    m_receivedValid = true;
+    ++m_revision;
+}
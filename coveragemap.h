@@ -0,0 +1,117 @@
+/**
+ * @file CoverageMap.h
+ * @brief This class computes the received signal strength over the whole level
+ * for one antenna configuration. Free-space path loss, the antenna pattern and
+ * the loss through the level's obstacles are combined per grid cell. Every term
+ * is cached in its own layer, so turning one control only recomputes the layers
+ * that depend on it: the power dial only shifts the result, the orientation dial
+ * only re-evaluates the antenna pattern, and line-of-sight ray casts only run
+ * when the antenna moves or the level changes.
+ *
+ * @author: Trentton Stratton, Phuc Hoang, Chanphone Visathip, Thu Ha.
+ * @date: 12/12/2024
+ */
+
+#ifndef COVERAGEMAP_H
+#define COVERAGEMAP_H
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "Box2D/Box2D.h"
+
+// The CoverageMap class holds the received power of every cell of the level.
+class CoverageMap
+{
+public:
+    // Antenna configuration the map is computed for.
+    struct Settings
+    {
+        b2Vec2 transmitLocation;
+        b2Vec2 transmitDirection;
+        float beamWidth;  // Degrees
+        int transmitPower;  // Watts
+        std::string frequencyBand;
+    };
+
+    /**
+     * Creates a map covering the rectangle [lower, upper] with square cells.
+     * @param lower The world position of the first cell corner.
+     * @param upper The world position of the last cell corner.
+     * @param cellSize The size of a cell in pixels.
+     */
+    CoverageMap(b2Vec2 lower, b2Vec2 upper, float cellSize);
+
+    /**
+     * Sets the obstacles that attenuate the signal.
+     * @param world The world holding the obstacle bodies; used for ray casts.
+     * @param losses Each obstacle body with its loss in dB at the VHF band.
+     */
+    void setObstacles(const b2World* world, const std::vector<std::pair<const b2Body*, float>>& losses);
+
+    // Brings the map up to date with the settings, recomputing only the
+    // layers whose inputs changed. Returns true if the result changed.
+    bool update(const Settings& settings);
+
+    // Received power in dBm of every cell, row by row.
+    const std::vector<float>& receivedPower() const { return m_received; }
+
+    int columns() const { return m_columns; }
+    int rows() const { return m_rows; }
+    float cellSize() const { return m_cellSize; }
+    b2Vec2 lower() const { return m_lower; }
+
+    // Incremented every time the received power changes.
+    unsigned revision() const { return m_revision; }
+
+    // Carrier frequency in MHz represented by a band name.
+    static float bandFrequency(const std::string& band);
+
+private:
+    // Ray cast callback summing the loss of every obstacle crossed.
+    class LossCallback : public b2RayCastCallback
+    {
+    public:
+        const std::vector<std::pair<const b2Body*, float>>* losses = nullptr;
+        float loss = 0.0f;
+
+        float32 ReportFixture(b2Fixture* fixture, const b2Vec2& point, const b2Vec2& normal, float32 fraction) override;
+    };
+
+    void updateGeometry();
+    void updatePathLoss();
+    void updateGain();
+    void updateReceived();
+
+    b2Vec2 m_lower;
+    float m_cellSize;
+    int m_columns;
+    int m_rows;
+
+    const b2World* m_world = nullptr;
+    std::vector<std::pair<const b2Body*, float>> m_obstacleLosses;
+
+    // Layer inputs, compared on every update.
+    bool m_geometryValid = false;
+    bool m_pathLossValid = false;
+    bool m_gainValid = false;
+    bool m_receivedValid = false;
+    Settings m_settings;
+
+    // Geometry layer: depends on the antenna location and the obstacles.
+    std::vector<float> m_distance;  // Distance to the antenna, in pixels
+    std::vector<b2Vec2> m_bearing;  // Unit vector from the antenna
+    std::vector<float> m_obstacleLoss;  // Obstacle loss along the line of sight at VHF, in dB
+
+    // Band layer: path loss in dB, free space plus obstacles.
+    std::vector<float> m_pathLoss;
+
+    // Pattern layer: antenna gain in dBi.
+    std::vector<float> m_gain;
+
+    // Result: received power in dBm.
+    std::vector<float> m_received;
+    unsigned m_revision = 0;
+};
+
+#endif // COVERAGEMAP_H
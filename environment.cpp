@@ -7,43 +7,185 @@
 
 #include "environment.h"
 
+#include <cmath>
+
 Environment::Environment(QWidget* parent) : QWidget(parent){}
 
 void Environment::paintEvent(QPaintEvent* event) {
+    // Only the dirty area is repainted; the rest of the widget keeps its
+    // pixels from the previous paint.
+    const QRect dirty = event->rect();
     QPainter painter(this);
-    painter.drawPixmap(rect(), backGround);
 
-    painter.setPen(QPen(qRgb(0, 0, 0)));
-    painter.setBrush(QBrush(QColor(66, 200, 245, 100)));
+    // The background and the objects come from one cached layer at the
+    // screen's resolution, copied pixel for pixel.
+    qreal ratio = devicePixelRatioF();
+    if (!staticLayerValid || staticLayer.size() != size() * ratio) {
+        buildStaticLayer();
+    }
+    painter.drawPixmap(QRectF(dirty), staticLayer,
+                       QRectF(dirty.x() * ratio, dirty.y() * ratio, dirty.width() * ratio, dirty.height() * ratio));
+
+    if (!coverage.isNull()) {
+        painter.drawImage(coverageRect, coverage);
+    }
+
+    if (waveView == WaveView::Amplitude) {
+        painter.drawImage(0, 0, amplitudeImage);
+    }
 
-    for(auto particle : particles) {
-        painter.drawEllipse(QPoint(particle.originalPos.x, particle.originalPos.y),
-                            particle.particleSize,particle.particleSize);
+    // All the particles are copies of one sprite, so they go to the paint
+    // engine as a single batch instead of one stroked and filled ellipse each.
+    if (particleSprite.width() != 2 * particleSize + 2) {
+        buildParticleSprite();
     }
+    if (particleQuality == ParticleQuality::Antialiased) {
+        painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    }
+    painter.drawPixmapFragments(particleFragments.constData(), particleFragments.size(), particleSprite);
+}
 
-    // Draw objects
+void Environment::buildStaticLayer() {
+    // The background is only rescaled when the widget or the screen changes;
+    // a new set of objects reuses it.
+    qreal ratio = devicePixelRatioF();
+    QSize pixels = size() * ratio;
+    if (scaledBackground.size() != pixels) {
+        scaledBackground = backGround.scaled(pixels, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        scaledBackground.setDevicePixelRatio(ratio);
+    }
+
+    staticLayer = scaledBackground.copy();
+    staticLayer.setDevicePixelRatio(ratio);
+    QPainter painter(&staticLayer);
     for (const auto& item : drawQueue) {
         const b2Vec2& pos = item.first;
-        const QPixmap& img = item.second;
-        QRect targetRect(pos.x - img.width() / 2,
-                         pos.y - img.height() / 2,
-                         img.width(), img.height());
-        painter.drawPixmap(targetRect, img);
+        const QRect& sprite = item.second;
+        QRect targetRect(pos.x - sprite.width() / 2,
+                         pos.y - sprite.height() / 2,
+                         sprite.width(), sprite.height());
+        painter.drawPixmap(targetRect, spriteSheet, sprite);
     }
+    painter.end();
+    staticLayerValid = true;
 }
 
-void Environment::drawParticles(QVector<b2Vec2> particlesPos) {
-    int size = 3; //2
-    for(auto particlePos : particlesPos) {
-        particles.append(Particle(size, particlePos));
+void Environment::drawParticles(const std::vector<b2Vec2>& previousPos, const std::vector<b2Vec2>& particlesPos, float alpha) {
+    if (waveView == WaveView::Amplitude && amplitudeRenderer.hasLattice()) {
+        if (amplitudeImage.size() != size()) {
+            amplitudeImage = QImage(size(), QImage::Format_ARGB32_Premultiplied);
+        }
+        amplitudeRenderer.render(previousPos, particlesPos, alpha,
+                                 reinterpret_cast<uint32_t*>(amplitudeImage.bits()),
+                                 amplitudeImage.width(), amplitudeImage.height(),
+                                 amplitudeImage.bytesPerLine() / 4);
+        particleFragments.resize(0);
+        update();
+        return;
+    }
+
+    // resize() never shrinks the capacity, so after the first frame this
+    // only overwrites.
+    bool resized = particleFragments.size() != int(particlesPos.size());
+    particleFragments.resize(int(particlesPos.size()));
+    QPainter::PixmapFragment* fragments = particleFragments.data();
+    qreal extent = 2 * particleSize + 2;
+    bool wholePixels = particleQuality == ParticleQuality::Fast;
+
+    // Bounding box of where the particles that moved were and are now. Only
+    // the mesh around the wave moves, so that is all that needs repainting.
+    qreal left = width();
+    qreal top = height();
+    qreal right = 0;
+    qreal bottom = 0;
+    for (size_t i = 0; i < particlesPos.size(); ++i) {
+        b2Vec2 particlePos = previousPos[i] + alpha * (particlesPos[i] - previousPos[i]);
+        QPainter::PixmapFragment& fragment = fragments[i];
+        // Whole pixel centres keep the engine on its plain blit path.
+        qreal x = wholePixels ? std::round(particlePos.x) : particlePos.x;
+        qreal y = wholePixels ? std::round(particlePos.y) : particlePos.y;
+        if (!resized && (x != fragment.x || y != fragment.y)) {
+            left = std::min(left, std::min(x, fragment.x));
+            top = std::min(top, std::min(y, fragment.y));
+            right = std::max(right, std::max(x, fragment.x));
+            bottom = std::max(bottom, std::max(y, fragment.y));
+        }
+        fragment.x = x;
+        fragment.y = y;
+        fragment.sourceLeft = 0;
+        fragment.sourceTop = 0;
+        fragment.width = extent;
+        fragment.height = extent;
+        fragment.scaleX = 1;
+        fragment.scaleY = 1;
+        fragment.rotation = 0;
+        fragment.opacity = 1;
     }
+
+    if (resized) {
+        update();
+    } else if (left <= right) {
+        // One pixel more on each side covers the smoothing of subpixel positions.
+        qreal margin = extent / 2 + 1;
+        update(QRectF(left - margin, top - margin, right - left + 2 * margin, bottom - top + 2 * margin).toAlignedRect());
+    }
+}
+
+void Environment::setParticleQuality(ParticleQuality quality) {
+    particleQuality = quality;
+    particleSprite = QPixmap();
+    update();
+}
+
+void Environment::setWaveView(WaveView view) {
+    waveView = view;
+    amplitudeImage = QImage();
+    update();
+}
+
+void Environment::setLattice(const LatticeIndex& lattice) {
+    amplitudeRenderer.setLattice(lattice);
+}
+
+void Environment::buildParticleSprite() {
+    // One pixel of margin around the radius holds the outline.
+    int extent = 2 * particleSize + 2;
+    QImage sprite(extent, extent, QImage::Format_ARGB32_Premultiplied);
+    sprite.fill(Qt::transparent);
+
+    QPainter painter(&sprite);
+    painter.setRenderHint(QPainter::Antialiasing, particleQuality == ParticleQuality::Antialiased);
+    painter.setPen(QPen(qRgb(0, 0, 0)));
+    painter.setBrush(QBrush(QColor(66, 200, 245, 100)));
+    painter.drawEllipse(QPointF(extent / 2.0, extent / 2.0), particleSize, particleSize);
+    painter.end();
+
+    particleSprite = QPixmap::fromImage(sprite);
+}
+
+void Environment::clearLevel() {
+    particleFragments.resize(0);
+    amplitudeImage.fill(Qt::transparent);
+    clearObjects();
+}
+
+void Environment::clearObjects() {
+    drawQueue.resize(0);
+    staticLayerValid = false;
+    update();
+}
+
+void Environment::drawCoverage(const QImage& image, const QRectF& target) {
+    coverage = image;
+    coverageRect = target;
     update();
 }
 
-void Environment::drawObjects(b2Vec2 objectsPos, QPixmap img)
+void Environment::drawObjects(b2Vec2 objectsPos, const QRect& sprite)
 {
-    // Add object to the drawing queue
-    drawQueue.append({objectsPos, img});
+    // Add object to the drawing queue; it is drawn into the static layer
+    drawQueue.append({objectsPos, sprite});
+    staticLayerValid = false;
     update();
 }
 
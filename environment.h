@@ -10,7 +10,10 @@
 
 #include <QWidget>
 #include <QPainter>
+#include <QImage>
 #include <Box2D/Box2D.h>
+#include <vector>
+#include "amplituderenderer.h"
 #include <QTimer>
 #include <QDebug>
 
@@ -20,45 +23,101 @@ class Environment : public QWidget
     Q_OBJECT
 
 public:
-    // Constructor: Initializes a new instance of the Environment class with an optional parent widget.
-    explicit Environment(QWidget* parent = nullptr);
+    // How particles are drawn. Fast blits an aliased sprite at whole pixels;
+    // Antialiased blends an antialiased sprite at subpixel positions.
+    enum class ParticleQuality
+    {
+        Fast,
+        Antialiased
+    };
 
-    // Nested class for particle management in the game environment.
-    class Particle
+    // What the wave is drawn as: the displaced particles, or a heatmap of
+    // how far each part of the mesh is displaced.
+    enum class WaveView
     {
-    public:
-        // Constructor: Creates a particle with a specific size and initial position.
-        Particle(int size, b2Vec2 pos)
-            :particleSize(size), originalPos(pos) {}
-
-        b2Body* body; // Box2D body associated with the particle
-        int particleSize; // Size of the particle
-        b2Vec2 originalPos; // Original position of the particle
+        Particles,
+        Amplitude
     };
 
+    // Constructor: Initializes a new instance of the Environment class with an optional parent widget.
+    explicit Environment(QWidget* parent = nullptr);
+
     /**
-     * Draws the specified object at the given position.
+     * Draws the specified object at the given position. Objects are drawn
+     * into the cached background layer, under the coverage and the wave.
      * @param object The position of the object to draw.
-     * @param img The image (pixmap) used to represent the object.
+     * @param sprite The area of spriteSheet holding the object's image.
      */
-    void drawObjects(b2Vec2 object, QPixmap img);
+    void drawObjects(b2Vec2 object, const QRect& sprite);
 
     /**
-     * Draws particles at specified locations.
+     * Draws particles blended between their last two simulated positions. The
+     * blended positions overwrite those of the previous frame in place, and
+     * the repaint is scheduled rather than done, so several calls between two
+     * paints cost one paint.
+     * @param previous Vector of positions one simulation step earlier.
      * @param particles Vector of positions where particles should be drawn.
+     * @param alpha Blend factor, 0 for the previous positions and 1 for the latest.
      */
-    void drawParticles(const QVector<b2Vec2> particles);
+    void drawParticles(const std::vector<b2Vec2>& previous, const std::vector<b2Vec2>& particles, float alpha);
 
-    // Vector containing all particles in the environment.
-    QVector<Particle> particles;
+    /**
+     * Draws a coverage heatmap over the background, under the particles.
+     * @param image The heatmap, or a null image to hide it.
+     * @param target The area of the level the heatmap covers.
+     */
+    void drawCoverage(const QImage& image, const QRectF& target);
+
+    // Switches the particle rendering quality; takes effect at the next frame.
+    void setParticleQuality(ParticleQuality quality);
+
+    // Switches between the particle and amplitude views; takes effect at the
+    // next frame. The amplitude view needs the mesh lattice.
+    void setWaveView(WaveView view);
+    void setLattice(const LatticeIndex& lattice);
+
+    // Forgets the particles and objects of the previous level. The widget
+    // itself lives as long as the main window.
+    void clearLevel();
+    // Removes the objects, before a new set is drawn.
+    void clearObjects();
+
+    // One sprite copy per particle of the current frame, drawn in a single
+    // call. The buffer keeps its capacity across frames and levels, so drawing
+    // allocates nothing once it is sized.
+    QVector<QPainter::PixmapFragment> particleFragments;
+    // A particle, outline and fill, prerendered for the current quality.
+    QPixmap particleSprite;
+    ParticleQuality particleQuality = ParticleQuality::Fast;
+    WaveView waveView = WaveView::Particles;
+    // Displacement heatmap of the current frame, in widget pixels, and its renderer.
+    QImage amplitudeImage;
+    AmplitudeRenderer amplitudeRenderer;
+    // Coverage heatmap and the area it covers.
+    QImage coverage;
+    QRectF coverageRect;
+    // Radius of the drawn particles.
+    int particleSize = 3;
     // Box2D body representing a rock in the environment.
     b2Body* rock;
-    // Queue of pairs consisting of positions and images to be drawn in the current frame.
-    QVector<std::pair<b2Vec2, QPixmap>> drawQueue;
+    // Queue of pairs consisting of positions and sprites to be drawn in the current frame.
+    QVector<std::pair<b2Vec2, QRect>> drawQueue;
+    // Images of all the objects, packed by SpriteAtlas.
+    QPixmap spriteSheet;
     // Background image for level 1 of the game.
     QPixmap backGround = QPixmap(":/img/backgroundLv1.jpg");
+    // The background scaled to the widget in device pixels, and the same with
+    // the objects drawn on it. Both are rebuilt only when they go stale.
+    QPixmap scaledBackground;
+    QPixmap staticLayer;
+    bool staticLayerValid = false;
 
 protected:
+    // Renders particleSprite for the current size and quality.
+    void buildParticleSprite();
+    // Renders staticLayer for the current size, screen and objects.
+    void buildStaticLayer();
+
     // Overridden paint event to handle custom drawing of the widget.
     void paintEvent(QPaintEvent* event) override;
 };
@@ -0,0 +1,326 @@
+/**
+ * This class is the grid propagation engine.
+ *
+ * It integrates the scalar wave equation u_tt = c^2 (u_xx + u_yy) - 2d u_t
+ * with the standard leapfrog stencil. The field is read as a velocity
+ * potential: the displacement of the medium is its gradient, which lets the
+ * grid produce the same particle displacements as the mesh.
+ */
+
+#include "fdtdsolver.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+// Courant number kept below the 2D stability limit of 1/sqrt(2).
+const float maxCourant = 0.7f;
+
+#if defined(__AVX__)
+const int simdWidth = 8;
+#elif defined(__SSE2__) || defined(_M_X64)
+const int simdWidth = 4;
+#else
+const int simdWidth = 1;
+#endif
+
+int substepCount(float dt, float waveSpeed, float cellSize)
+{
+    return std::max(1, int(std::ceil(waveSpeed * dt / (cellSize * maxCourant))));
+}
+}
+
+FdtdSolver::FdtdSolver(b2Vec2 lower, b2Vec2 upper, float cellSize)
+    : m_lower(lower), m_cellSize(cellSize)
+{
+    m_columns = int((upper.x - lower.x) / cellSize) + 1;
+    m_rows = int((upper.y - lower.y) / cellSize) + 1;
+    m_stride = (m_columns + simdWidth - 1) / simdWidth * simdWidth;
+
+    m_storage.assign(3 * size_t(m_stride) * m_rows, 0.0f);
+    m_previous = m_storage.data();
+    m_current = m_previous + size_t(m_stride) * m_rows;
+    m_next = m_current + size_t(m_stride) * m_rows;
+
+    setThreadCount(0);
+}
+
+FdtdSolver::~FdtdSolver()
+{
+    setThreadCount(1);
+}
+
+void FdtdSolver::setWaveSpeed(float speed)
+{
+    m_waveSpeed = speed;
+}
+
+void FdtdSolver::setDamping(float damping)
+{
+    m_damping = damping;
+}
+
+void FdtdSolver::setAbsorbingLayer(float width, float damping)
+{
+    m_layerWidth = std::max(width, 0.0f);
+    m_layerDamping = std::max(damping, 0.0f);
+    m_layerCells = m_layerDamping > 0.0f ? int(std::ceil(m_layerWidth / m_cellSize)) - 1 : 0;
+    m_layerCells = std::max(0, std::min(m_layerCells, (std::min(m_columns, m_rows) - 2) / 2));
+}
+
+void FdtdSolver::setThreadCount(int threads)
+{
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // Bands narrower than a few rows cost more to hand out than to compute.
+    threads = std::max(1, std::min(threads, (m_rows - 2) / 8));
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_start.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+
+    // No worker is running here, so the shared state can be set without the
+    // lock. Workers start from the current generation so a step issued before
+    // they first wait is not missed.
+    m_quit = false;
+    m_bandCount = threads;
+    for (int band = 1; band < m_bandCount; ++band) {
+        m_workers.emplace_back(&FdtdSolver::workerLoop, this, band, m_generation);
+    }
+}
+
+void FdtdSolver::workerLoop(int band, unsigned seenGeneration)
+{
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [&]() { return m_quit || m_generation != seenGeneration; });
+            if (m_quit) {
+                return;
+            }
+            seenGeneration = m_generation;
+        }
+
+        int interior = m_rows - 2;
+        int firstRow = 1 + interior * band / m_bandCount;
+        int lastRow = 1 + interior * (band + 1) / m_bandCount;
+        stepRows(firstRow, lastRow, m_bandCourant2, m_bandDamping);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_pending;
+        }
+        m_done.notify_one();
+    }
+}
+
+void FdtdSolver::runBands(float courant2, float damping)
+{
+    int interior = m_rows - 2;
+    if (m_bandCount == 1) {
+        stepRows(1, 1 + interior, courant2, damping);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bandCourant2 = courant2;
+        m_bandDamping = damping;
+        m_pending = m_bandCount - 1;
+        ++m_generation;
+    }
+    m_start.notify_all();
+
+    stepRows(1, 1 + interior / m_bandCount, courant2, damping);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&]() { return m_pending == 0; });
+}
+
+void FdtdSolver::stepRows(int firstRow, int lastRow, float courant2, float damping)
+{
+    // next = a * (2u - b * previous + C^2 * laplacian(u)), with the damping
+    // term discretised symmetrically around the current time level.
+    const float a = 1.0f / (1.0f + damping);
+    const float b = 1.0f - damping;
+    const int lastColumn = m_columns - 1;
+
+    for (int row = firstRow; row < lastRow; ++row) {
+        const float* u = m_current + size_t(row) * m_stride;
+        const float* up = u - m_stride;
+        const float* down = u + m_stride;
+        const float* previous = m_previous + size_t(row) * m_stride;
+        float* next = m_next + size_t(row) * m_stride;
+
+        int column = 1;
+#if defined(__AVX__)
+        const __m256 va = _mm256_set1_ps(a);
+        const __m256 vb = _mm256_set1_ps(b);
+        const __m256 vc = _mm256_set1_ps(courant2);
+        const __m256 four = _mm256_set1_ps(4.0f);
+        for (; column + 8 <= lastColumn; column += 8) {
+            __m256 center = _mm256_loadu_ps(u + column);
+            __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(u + column - 1), _mm256_loadu_ps(u + column + 1)),
+                                       _mm256_add_ps(_mm256_loadu_ps(up + column), _mm256_loadu_ps(down + column)));
+            __m256 laplacian = _mm256_sub_ps(sum, _mm256_mul_ps(four, center));
+            __m256 value = _mm256_sub_ps(_mm256_add_ps(center, center), _mm256_mul_ps(vb, _mm256_loadu_ps(previous + column)));
+            value = _mm256_add_ps(value, _mm256_mul_ps(vc, laplacian));
+            _mm256_storeu_ps(next + column, _mm256_mul_ps(va, value));
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        const __m128 va = _mm_set1_ps(a);
+        const __m128 vb = _mm_set1_ps(b);
+        const __m128 vc = _mm_set1_ps(courant2);
+        const __m128 four = _mm_set1_ps(4.0f);
+        for (; column + 4 <= lastColumn; column += 4) {
+            __m128 center = _mm_loadu_ps(u + column);
+            __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(u + column - 1), _mm_loadu_ps(u + column + 1)),
+                                    _mm_add_ps(_mm_loadu_ps(up + column), _mm_loadu_ps(down + column)));
+            __m128 laplacian = _mm_sub_ps(sum, _mm_mul_ps(four, center));
+            __m128 value = _mm_sub_ps(_mm_add_ps(center, center), _mm_mul_ps(vb, _mm_loadu_ps(previous + column)));
+            value = _mm_add_ps(value, _mm_mul_ps(vc, laplacian));
+            _mm_storeu_ps(next + column, _mm_mul_ps(va, value));
+        }
+#endif
+        for (; column < lastColumn; ++column) {
+            float center = u[column];
+            float laplacian = (u[column - 1] + u[column + 1]) + (up[column] + down[column]) - 4.0f * center;
+            float value = (center + center) - b * previous[column];
+            value = value + courant2 * laplacian;
+            next[column] = a * value;
+        }
+
+        // Absorbing layer: scale the velocity of this sub-step, next - u,
+        // by the implicit damping factor of the node's depth.
+        int rowDepth = std::min(row, m_rows - 1 - row);
+        if (rowDepth <= m_layerCells) {
+            for (column = 1; column < lastColumn; ++column) {
+                int depth = std::min(rowDepth, std::min(column, lastColumn - column));
+                next[column] = u[column] + m_layerFactors[depth] * (next[column] - u[column]);
+            }
+        } else if (m_layerCells > 0) {
+            for (int depth = 1; depth <= m_layerCells; ++depth) {
+                next[depth] = u[depth] + m_layerFactors[depth] * (next[depth] - u[depth]);
+                int right = lastColumn - depth;
+                next[right] = u[right] + m_layerFactors[depth] * (next[right] - u[right]);
+            }
+        }
+    }
+}
+
+void FdtdSolver::step(float dt)
+{
+    int substeps = substepCount(dt, m_waveSpeed, m_cellSize);
+    float h = dt / substeps;
+    float courant = m_waveSpeed * h / m_cellSize;
+    float courant2 = courant * courant;
+    float damping = m_damping * h;
+
+    // The layer's rate falls off quadratically with the distance from the
+    // border, the grading a perfectly matched layer uses.
+    m_layerFactors.assign(size_t(m_layerCells) + 1, 1.0f);
+    for (int depth = 1; depth <= m_layerCells; ++depth) {
+        float x = 1.0f - depth * m_cellSize / m_layerWidth;
+        m_layerFactors[size_t(depth)] = 1.0f / (1.0f + h * m_layerDamping * x * x);
+    }
+
+    for (int i = 0; i < substeps; ++i) {
+        runBands(courant2, damping);
+
+        // Rotate the time levels. The border rows and columns of every level
+        // stay at zero, which pins the edges of the medium like the mesh walls.
+        float* previous = m_previous;
+        m_previous = m_current;
+        m_current = m_next;
+        m_next = previous;
+    }
+}
+
+void FdtdSolver::reset()
+{
+    std::fill(m_storage.begin(), m_storage.end(), 0.0f);
+}
+
+void FdtdSolver::addRadialKick(b2Vec2 center, float radius, float speed, b2Vec2 direction, float minCos, float dt)
+{
+    // A velocity potential of -speed * (radius - r) has a gradient of speed
+    // pointing away from the center. Changing the field velocity means
+    // moving the previous time level back by that much over one sub-step.
+    float h = dt / substepCount(dt, m_waveSpeed, m_cellSize);
+
+    int firstColumn = std::max(1, int(std::floor((center.x - radius - m_lower.x) / m_cellSize)));
+    int lastColumn = std::min(m_columns - 2, int(std::ceil((center.x + radius - m_lower.x) / m_cellSize)));
+    int firstRow = std::max(1, int(std::floor((center.y - radius - m_lower.y) / m_cellSize)));
+    int lastRow = std::min(m_rows - 2, int(std::ceil((center.y + radius - m_lower.y) / m_cellSize)));
+
+    for (int row = firstRow; row <= lastRow; ++row) {
+        float* previous = m_previous + size_t(row) * m_stride;
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            b2Vec2 offset(m_lower.x + column * m_cellSize - center.x, m_lower.y + row * m_cellSize - center.y);
+            float distance = offset.Length();
+            if (distance > radius) {
+                continue;
+            }
+            if (distance > 0.0f && b2Dot(direction, offset) < minCos * distance) {
+                continue;
+            }
+            previous[column] += speed * (radius - distance) * h;
+        }
+    }
+}
+
+void FdtdSolver::addNodeImpulse(int column, int row, float amount)
+{
+    if (column < 1 || column > m_columns - 2 || row < 1 || row > m_rows - 2) {
+        return;
+    }
+    m_previous[size_t(row) * m_stride + column] += amount;
+}
+
+float FdtdSolver::substepLength(float dt) const
+{
+    return dt / substepCount(dt, m_waveSpeed, m_cellSize);
+}
+
+float FdtdSolver::at(int column, int row) const
+{
+    column = std::max(0, std::min(column, m_columns - 1));
+    row = std::max(0, std::min(row, m_rows - 1));
+    return m_current[size_t(row) * m_stride + column];
+}
+
+float FdtdSolver::sample(b2Vec2 position) const
+{
+    float x = (position.x - m_lower.x) / m_cellSize;
+    float y = (position.y - m_lower.y) / m_cellSize;
+    int column = int(std::floor(x));
+    int row = int(std::floor(y));
+    float fx = x - column;
+    float fy = y - row;
+
+    float top = at(column, row) + fx * (at(column + 1, row) - at(column, row));
+    float bottom = at(column, row + 1) + fx * (at(column + 1, row + 1) - at(column, row + 1));
+    return top + fy * (bottom - top);
+}
+
+b2Vec2 FdtdSolver::displacement(b2Vec2 position) const
+{
+    float h = m_cellSize;
+    float dx = sample(position + b2Vec2(h, 0.0f)) - sample(position - b2Vec2(h, 0.0f));
+    float dy = sample(position + b2Vec2(0.0f, h)) - sample(position - b2Vec2(0.0f, h));
+    return b2Vec2(dx / (2.0f * h), dy / (2.0f * h));
+}
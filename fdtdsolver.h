@@ -0,0 +1,138 @@
+/**
+ * @file FdtdSolver.h
+ * @brief This class solves the 2D scalar wave equation on a regular grid with a
+ * finite-difference time-domain (FDTD) stencil. It is the grid alternative to the
+ * particle mesh for propagating the radio wave. The stencil is vectorised with
+ * SSE/AVX where available and split across cores by row bands; every cell is
+ * computed independently, so results do not depend on the number of threads.
+ *
+ * @author: Trentton Stratton, Phuc Hoang, Chanphone Visathip, Thu Ha.
+ * @date: 12/12/2024
+ */
+
+#ifndef FDTDSOLVER_H
+#define FDTDSOLVER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Box2D/Common/b2Math.h"
+
+// The FdtdSolver class integrates the scalar wave field of the grid mode.
+class FdtdSolver
+{
+public:
+    /**
+     * Creates a grid covering the rectangle [lower, upper] with square cells.
+     * @param lower The world position of the first grid node.
+     * @param upper The world position of the last grid node.
+     * @param cellSize The distance between neighbouring grid nodes.
+     */
+    FdtdSolver(b2Vec2 lower, b2Vec2 upper, float cellSize);
+    ~FdtdSolver();
+
+    FdtdSolver(const FdtdSolver&) = delete;
+    FdtdSolver& operator=(const FdtdSolver&) = delete;
+
+    // Sets the propagation speed and the uniform damping rate (1/s) of the medium.
+    void setWaveSpeed(float speed);
+    void setDamping(float damping);
+
+    /**
+     * Damps the field velocity in a layer along the edges, so waves leave the
+     * grid instead of reflecting off its pinned border, like the absorbing
+     * layer of the particle mesh. The damping is integrated implicitly, so it
+     * is stable at any strength.
+     * @param width The depth of the layer in world units; 0 removes it.
+     * @param damping The rate (1/s) next to the border. It falls off
+     * quadratically to zero at the inner edge of the layer.
+     */
+    void setAbsorbingLayer(float width, float damping);
+
+    // Sets the number of threads used by step(); 0 uses every core.
+    void setThreadCount(int threads);
+
+    // Advances the field by dt, sub-stepping as needed to respect the CFL limit.
+    void step(float dt);
+
+    // Puts the whole field back to rest.
+    void reset();
+
+    /**
+     * Adds a radial velocity kick to the field. Inside the disc the displacement
+     * (the gradient of the field) moves away from the center at the given speed.
+     * @param center The center of the kick.
+     * @param radius The radius of the kicked disc.
+     * @param speed The displacement speed of the kicked nodes.
+     * @param direction The beam direction.
+     * @param minCos Nodes whose direction from the center has a smaller cosine with the beam are left alone.
+     * @param dt The time step the kick is applied over.
+     */
+    void addRadialKick(b2Vec2 center, float radius, float speed, b2Vec2 direction, float minCos, float dt);
+
+    // Moves the previous time level of one interior node by amount, the
+    // operation addRadialKick applies to every node of its disc.
+    void addNodeImpulse(int column, int row, float amount);
+
+    // Length of the sub-steps step(dt) takes.
+    float substepLength(float dt) const;
+
+    // Bilinearly interpolated field value at a world position.
+    float sample(b2Vec2 position) const;
+
+    // Displacement of the medium at a world position (the gradient of the field).
+    b2Vec2 displacement(b2Vec2 position) const;
+
+    int columns() const { return m_columns; }
+    int rows() const { return m_rows; }
+    float cellSize() const { return m_cellSize; }
+    b2Vec2 lower() const { return m_lower; }
+
+    // Field values of the current time level; row r starts at field() + r * stride().
+    const float* field() const { return m_current; }
+    // Field values of the previous time level, laid out as field().
+    const float* previousField() const { return m_previous; }
+    int stride() const { return m_stride; }
+
+private:
+    void stepRows(int firstRow, int lastRow, float courant2, float damping);
+    void runBands(float courant2, float damping);
+    void workerLoop(int band, unsigned seenGeneration);
+    float at(int column, int row) const;
+
+    b2Vec2 m_lower;
+    float m_cellSize;
+    int m_columns;
+    int m_rows;
+    int m_stride;  // Row length padded to the SIMD width
+
+    float m_waveSpeed = 300.0f;
+    float m_damping = 0.2f;
+    float m_layerWidth = 0.0f;
+    float m_layerDamping = 0.0f;
+    int m_layerCells = 0;  // Nodes inside the border that the layer damps
+    // Velocity factor of the layer nodes for the current sub-step length,
+    // by depth in nodes from the border (index 0 is unused).
+    std::vector<float> m_layerFactors;
+
+    // Three time levels of the field, rotated every sub-step.
+    std::vector<float> m_storage;
+    float* m_previous;
+    float* m_current;
+    float* m_next;
+
+    // Persistent worker pool; band 0 runs on the calling thread.
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+    unsigned m_generation = 0;
+    int m_pending = 0;
+    int m_bandCount = 1;
+    bool m_quit = false;
+    float m_bandCourant2 = 0.0f;
+    float m_bandDamping = 0.0f;
+};
+
+#endif // FDTDSOLVER_H
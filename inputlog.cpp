@@ -0,0 +1,253 @@
+/**
+ * This class is the session recorder and replayer.
+ *
+ * It writes the player's commands to a binary log
+ * with their step indices, and plays a log back on
+ * a headless simulation at full speed.
+ */
+
+#include "inputlog.h"
+#include "wavesimulation.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+const char logTag[4] = {'R', 'L', 'O', 'G'};
+const unsigned char logVersion = 1;
+
+unsigned long long zigzag(long long value)
+{
+    return (static_cast<unsigned long long>(value) << 1) ^ static_cast<unsigned long long>(value >> 63);
+}
+
+long long unzigzag(unsigned long long value)
+{
+    return static_cast<long long>(value >> 1) ^ -static_cast<long long>(value & 1);
+}
+
+bool readVarint(std::istream& in, unsigned long long& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = in.get();
+        if (byte == std::char_traits<char>::eof()) {
+            return false;
+        }
+        value |= static_cast<unsigned long long>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool hasText(InputCommand command)
+{
+    return command == InputCommand::AntennaType || command == InputCommand::FrequencyBand;
+}
+}
+
+void applyInputEvent(WaveSimulation& simulation, const InputEvent& event)
+{
+    switch (event.command) {
+    case InputCommand::ResetLevel:
+        simulation.resetLevel(int(event.value));
+        break;
+    case InputCommand::AntennaType:
+        simulation.setAntennaType(event.text);
+        break;
+    case InputCommand::FrequencyBand:
+        simulation.setFrequencyBand(event.text);
+        break;
+    case InputCommand::TransmitPower:
+        simulation.setTransmitPower(int(event.value));
+        break;
+    case InputCommand::AntennaHeight:
+        simulation.setAntennaHeight(int(event.value));
+        break;
+    case InputCommand::AntennaOrientation:
+        simulation.setAntennaOrientation(int(event.value));
+        break;
+    case InputCommand::PropagationMode:
+        simulation.setPropagationMode(static_cast<PropagationMode>(event.value));
+        break;
+    case InputCommand::ContinuousWave:
+        simulation.setContinuousWave(event.value != 0);
+        break;
+    case InputCommand::EmitWave:
+        simulation.emitWave();
+        break;
+    case InputCommand::End:
+        break;
+    }
+}
+
+bool InputRecorder::open(const std::string& path, int levelNumber)
+{
+    m_out.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_out) {
+        return false;
+    }
+    m_out.write(logTag, sizeof(logTag));
+    m_out.put(char(logVersion));
+    writeVarint(zigzag(levelNumber));
+    m_out.flush();
+    m_lastStep = 0;
+    return true;
+}
+
+void InputRecorder::record(unsigned long long step, InputCommand command, long long value)
+{
+    if (!isOpen()) {
+        return;
+    }
+    writeHeader(step, command);
+    writeVarint(zigzag(value));
+    m_out.flush();
+}
+
+void InputRecorder::record(unsigned long long step, InputCommand command, const std::string& text)
+{
+    if (!isOpen()) {
+        return;
+    }
+    writeHeader(step, command);
+    writeVarint(text.size());
+    m_out.write(text.data(), std::streamsize(text.size()));
+    m_out.flush();
+}
+
+void InputRecorder::record(unsigned long long step, const InputEvent& event)
+{
+    if (hasText(event.command)) {
+        record(step, event.command, event.text);
+    } else {
+        record(step, event.command, event.value);
+    }
+}
+
+void InputRecorder::close(unsigned long long step, unsigned long long stateHash)
+{
+    if (!isOpen()) {
+        return;
+    }
+    writeHeader(step, InputCommand::End);
+    writeVarint(stateHash);
+    m_out.close();
+}
+
+void InputRecorder::writeHeader(unsigned long long step, InputCommand command)
+{
+    writeVarint(step - std::min(step, m_lastStep));
+    m_out.put(char(command));
+    m_lastStep = step;
+}
+
+void InputRecorder::writeVarint(unsigned long long value)
+{
+    while (value >= 0x80) {
+        m_out.put(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    m_out.put(char(value));
+}
+
+bool InputLog::load(const std::string& path)
+{
+    m_events.clear();
+
+    std::ifstream in(path, std::ios::binary);
+    char tag[sizeof(logTag)];
+    if (!in.read(tag, sizeof(tag)) || !std::equal(tag, tag + sizeof(tag), logTag) || in.get() != logVersion) {
+        return false;
+    }
+    unsigned long long level = 0;
+    if (!readVarint(in, level)) {
+        return false;
+    }
+    m_levelNumber = int(unzigzag(level));
+
+    unsigned long long step = 0;
+    for (;;) {
+        InputEvent event;
+        unsigned long long delta = 0;
+        if (!readVarint(in, delta)) {
+            break;
+        }
+        int command = in.get();
+        if (command < int(InputCommand::ResetLevel) || command > int(InputCommand::End)) {
+            break;
+        }
+        event.step = step + delta;
+        event.command = static_cast<InputCommand>(command);
+
+        unsigned long long argument = 0;
+        if (!readVarint(in, argument)) {
+            break;
+        }
+        if (hasText(event.command)) {
+            event.text.resize(argument);
+            if (!in.read(&event.text[0], std::streamsize(argument))) {
+                break;
+            }
+        } else {
+            event.value = event.command == InputCommand::End ? static_cast<long long>(argument) : unzigzag(argument);
+        }
+
+        step = event.step;
+        m_events.push_back(event);
+        if (event.command == InputCommand::End) {
+            break;
+        }
+    }
+    return true;
+}
+
+ReplayResult InputLog::replay(int slowestCount) const
+{
+    ReplayResult result;
+    WaveSimulation simulation(m_levelNumber);
+    slowestCount = std::max(0, slowestCount);
+
+    // Keeps the slowest steps as a min-heap on time.
+    auto faster = [](const std::pair<double, unsigned long long>& a, const std::pair<double, unsigned long long>& b) {
+        return a.first > b.first;
+    };
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (const InputEvent& event : m_events) {
+        while (result.steps < event.step) {
+            std::chrono::steady_clock::time_point stepStart = std::chrono::steady_clock::now();
+            simulation.step();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - stepStart).count();
+
+            if (slowestCount > 0) {
+                if (int(result.slowestSteps.size()) < slowestCount) {
+                    result.slowestSteps.emplace_back(seconds, result.steps);
+                    std::push_heap(result.slowestSteps.begin(), result.slowestSteps.end(), faster);
+                } else if (seconds > result.slowestSteps.front().first) {
+                    std::pop_heap(result.slowestSteps.begin(), result.slowestSteps.end(), faster);
+                    result.slowestSteps.back() = std::make_pair(seconds, result.steps);
+                    std::push_heap(result.slowestSteps.begin(), result.slowestSteps.end(), faster);
+                }
+            }
+            ++result.steps;
+        }
+
+        if (event.command == InputCommand::End) {
+            result.stateHash = simulation.getStateHash();
+            result.verified = result.stateHash == static_cast<unsigned long long>(event.value);
+        } else {
+            applyInputEvent(simulation, event);
+        }
+    }
+    result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (m_events.empty() || m_events.back().command != InputCommand::End) {
+        result.stateHash = simulation.getStateHash();
+    }
+    std::sort_heap(result.slowestSteps.begin(), result.slowestSteps.end(), faster);
+    return result;
+}
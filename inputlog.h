@@ -0,0 +1,119 @@
+/**
+ * @file InputLog.h
+ * @brief These classes record a play session and play it back headlessly. Every
+ * control change reaching the simulation is written to a compact binary log
+ * together with the index of the step it arrived before. The simulation only
+ * depends on its inputs and on the steps taken, not on real time, so replaying
+ * the log on a fresh simulation as fast as the CPU allows reproduces the session
+ * bit for bit, including its slow steps.
+ *
+ * The log is a "RLOG" tag and a version byte, the starting level, then one
+ * record per command: the steps since the previous record, the command byte and
+ * its argument. Integers are LEB128 varints, signed ones zigzag-encoded first.
+ * Records are flushed as they are written, so a log survives a crash.
+ *
+ * @author: Trentton Stratton, Phuc Hoang, Chanphone Visathip, Thu Ha.
+ * @date: 12/12/2024
+ */
+
+#ifndef INPUTLOG_H
+#define INPUTLOG_H
+
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+class WaveSimulation;
+
+// Commands the player can send to the simulation. The values are stored in
+// logs, so existing ones must not change.
+enum class InputCommand : unsigned char
+{
+    ResetLevel = 1,  // Level number
+    AntennaType = 2,  // Antenna name
+    FrequencyBand = 3,  // Band name
+    TransmitPower = 4,  // Power level
+    AntennaHeight = 5,  // Height
+    AntennaOrientation = 6,  // Degrees
+    PropagationMode = 7,  // PropagationMode value
+    ContinuousWave = 8,  // 1 for on, 0 for off
+    EmitWave = 9,  // No argument
+    End = 10  // State hash of the recorded simulation
+};
+
+// One recorded command.
+struct InputEvent
+{
+    unsigned long long step = 0;  // Steps taken before the command was applied
+    InputCommand command = InputCommand::EmitWave;
+    long long value = 0;  // Integer argument
+    std::string text;  // Text argument
+};
+
+// Outcome of replaying a log.
+struct ReplayResult
+{
+    unsigned long long steps = 0;  // Steps played
+    double wallSeconds = 0.0;  // Real time the replay took
+    unsigned long long stateHash = 0;  // WaveSimulation::getStateHash() at the end
+    bool verified = false;  // Whether the log has an end record and its hash matches
+    std::vector<std::pair<double, unsigned long long>> slowestSteps;  // Seconds and index, slowest first
+};
+
+// The InputRecorder class writes commands to a log as they happen.
+class InputRecorder
+{
+public:
+    /**
+     * Starts a log, replacing any file at the path.
+     * @param path The file to write.
+     * @param levelNumber The level the simulation was created with.
+     * @return Whether the file could be opened.
+     */
+    bool open(const std::string& path, int levelNumber);
+    bool isOpen() const { return m_out.is_open(); }
+
+    // Records a command applied after step steps.
+    void record(unsigned long long step, InputCommand command, long long value = 0);
+    void record(unsigned long long step, InputCommand command, const std::string& text);
+    void record(unsigned long long step, const InputEvent& event);
+
+    // Writes the end record with the final simulation state and closes the log.
+    void close(unsigned long long step, unsigned long long stateHash);
+
+private:
+    void writeHeader(unsigned long long step, InputCommand command);
+    void writeVarint(unsigned long long value);
+
+    std::ofstream m_out;
+    unsigned long long m_lastStep = 0;
+};
+
+// Applies a command to a simulation the way the model does.
+void applyInputEvent(WaveSimulation& simulation, const InputEvent& event);
+
+// The InputLog class reads a log back and replays it.
+class InputLog
+{
+public:
+    // Reads a log. A log cut short by a crash loads up to its last whole
+    // record. Returns false if the file is missing or not a log.
+    bool load(const std::string& path);
+
+    int levelNumber() const { return m_levelNumber; }
+    const std::vector<InputEvent>& events() const { return m_events; }
+
+    /**
+     * Plays the log on a fresh simulation, stepping as fast as possible. It runs
+     * to the end record, or to the last command of an unfinished log.
+     * @param slowestCount The number of slowest steps to report.
+     */
+    ReplayResult replay(int slowestCount = 10) const;
+
+private:
+    int m_levelNumber = 1;
+    std::vector<InputEvent> m_events;
+};
+
+#endif // INPUTLOG_H
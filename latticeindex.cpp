@@ -0,0 +1,116 @@
+/**
+ * This class is the proximity index of the particle mesh.
+ *
+ * It maps points to lattice nodes arithmetically,
+ * since the mesh is a regular grid, and grows the
+ * searched area ring by ring for nearest-node queries.
+ */
+
+#include "latticeindex.h"
+
+#include <algorithm>
+#include <cmath>
+
+LatticeIndex::LatticeIndex(b2Vec2 origin, float spacing, int columns, int rows)
+    : m_origin(origin), m_spacing(spacing), m_columns(columns), m_rows(rows)
+{
+}
+
+LatticeIndex::Range LatticeIndex::range(b2Vec2 center, float radius) const
+{
+    b2AABB box;
+    box.lowerBound = center - b2Vec2(radius, radius);
+    box.upperBound = center + b2Vec2(radius, radius);
+    return range(box);
+}
+
+LatticeIndex::Range LatticeIndex::range(const b2AABB& box) const
+{
+    Range range;
+    range.firstColumn = std::max(0, int(std::ceil((box.lowerBound.x - m_origin.x) / m_spacing)));
+    range.lastColumn = std::min(m_columns - 1, int(std::floor((box.upperBound.x - m_origin.x) / m_spacing)));
+    range.firstRow = std::max(0, int(std::ceil((box.lowerBound.y - m_origin.y) / m_spacing)));
+    range.lastRow = std::min(m_rows - 1, int(std::floor((box.upperBound.y - m_origin.y) / m_spacing)));
+    return range;
+}
+
+b2Vec2 LatticeIndex::position(int32 node) const
+{
+    return m_origin + m_spacing * b2Vec2(float(node % m_columns), float(node / m_columns));
+}
+
+int32 LatticeIndex::nearest(b2Vec2 point) const
+{
+    if (m_columns <= 0 || m_rows <= 0) {
+        return -1;
+    }
+    int column = std::min(m_columns - 1, std::max(0, int(std::lround((point.x - m_origin.x) / m_spacing))));
+    int row = std::min(m_rows - 1, std::max(0, int(std::lround((point.y - m_origin.y) / m_spacing))));
+    return row * m_columns + column;
+}
+
+void LatticeIndex::queryRadius(b2Vec2 center, float radius, std::vector<int32>& nodes) const
+{
+    Range cells = range(center, radius);
+    float radiusSquared = radius * radius;
+
+    for (int row = cells.firstRow; row <= cells.lastRow; ++row) {
+        float dy = m_origin.y + row * m_spacing - center.y;
+        for (int column = cells.firstColumn; column <= cells.lastColumn; ++column) {
+            float dx = m_origin.x + column * m_spacing - center.x;
+            if (dx * dx + dy * dy <= radiusSquared) {
+                nodes.push_back(row * m_columns + column);
+            }
+        }
+    }
+}
+
+void LatticeIndex::queryNearest(b2Vec2 point, int k, std::vector<int32>& nodes) const
+{
+    int32 center = nearest(point);
+    if (center < 0 || k <= 0) {
+        return;
+    }
+    k = std::min(k, nodeCount());
+
+    const int centerColumn = center % m_columns;
+    const int centerRow = center / m_columns;
+    const int maxRing = std::max(std::max(centerColumn, m_columns - 1 - centerColumn),
+                                 std::max(centerRow, m_rows - 1 - centerRow));
+
+    // Local rather than kept between queries, so concurrent queries do not
+    // share it.
+    std::vector<std::pair<float, int32>> candidates;
+    for (int ring = 0; ring <= maxRing; ++ring) {
+        // Visit the cells at Chebyshev distance ring from the center node.
+        int firstRow = std::max(0, centerRow - ring);
+        int lastRow = std::min(m_rows - 1, centerRow + ring);
+        for (int row = firstRow; row <= lastRow; ++row) {
+            bool edgeRow = row == centerRow - ring || row == centerRow + ring;
+            int step = edgeRow ? 1 : 2 * ring;
+            for (int column = centerColumn - ring; column <= centerColumn + ring; column += std::max(1, step)) {
+                if (column < 0 || column >= m_columns) {
+                    continue;
+                }
+                int32 node = row * m_columns + column;
+                candidates.push_back(std::make_pair((position(node) - point).LengthSquared(), node));
+            }
+        }
+
+        // Nodes beyond this ring are at least ring + 1 spacings from the
+        // center node along one axis, and the point is at most half a spacing
+        // from the center node toward them, so none of them is closer than bound.
+        if (int(candidates.size()) >= k) {
+            std::nth_element(candidates.begin(), candidates.begin() + (k - 1), candidates.end());
+            float bound = (ring + 0.5f) * m_spacing;
+            if (candidates[k - 1].first <= bound * bound) {
+                break;
+            }
+        }
+    }
+
+    std::partial_sort(candidates.begin(), candidates.begin() + k, candidates.end());
+    for (int i = 0; i < k; ++i) {
+        nodes.push_back(candidates[i].second);
+    }
+}
@@ -0,0 +1,79 @@
+/**
+ * @file LatticeIndex.h
+ * @brief This class finds the particles of the regular particle mesh near a point
+ * without going through the Box2D broadphase. The mesh is a rectangular lattice,
+ * so the node under any point follows from its coordinates: the index only keeps
+ * the lattice origin, spacing and size, and answers radius and k-nearest queries
+ * by visiting the few lattice cells around the point. Queries use the rest
+ * positions of the nodes, which the nodes never stray far from.
+ *
+ * @author: Trentton Stratton, Phuc Hoang, Chanphone Visathip, Thu Ha.
+ * @date: 12/12/2024
+ */
+
+#ifndef LATTICEINDEX_H
+#define LATTICEINDEX_H
+
+#include <utility>
+#include <vector>
+#include "Box2D/Box2D.h"
+
+// The LatticeIndex class answers proximity queries on a regular lattice.
+// Nodes are numbered row by row from the lattice origin.
+class LatticeIndex
+{
+public:
+    // Lattice columns and rows overlapping a query, both ends included. The
+    // range is empty when first > last.
+    struct Range
+    {
+        int firstColumn;
+        int lastColumn;
+        int firstRow;
+        int lastRow;
+    };
+
+    LatticeIndex() = default;
+
+    /**
+     * Describes the lattice to index.
+     * @param origin The rest position of node 0.
+     * @param spacing The distance between neighbouring nodes.
+     * @param columns The number of nodes in a row.
+     * @param rows The number of rows.
+     */
+    LatticeIndex(b2Vec2 origin, float spacing, int columns, int rows);
+
+    // Columns and rows of the nodes inside the square of half size radius
+    // around center.
+    Range range(b2Vec2 center, float radius) const;
+    // Columns and rows of the nodes inside a box.
+    Range range(const b2AABB& box) const;
+
+    // Rest position of a node.
+    b2Vec2 position(int32 node) const;
+
+    // Node closest to a point, or -1 if the lattice is empty.
+    int32 nearest(b2Vec2 point) const;
+
+    // Appends every node within radius of center, row by row.
+    void queryRadius(b2Vec2 center, float radius, std::vector<int32>& nodes) const;
+
+    // Appends the k nodes closest to point, closest first. Only the rings of
+    // cells needed to settle the k-th node are visited. Like every query, it
+    // may run on several threads at once.
+    void queryNearest(b2Vec2 point, int k, std::vector<int32>& nodes) const;
+
+    int columns() const { return m_columns; }
+    int rows() const { return m_rows; }
+    float spacing() const { return m_spacing; }
+    int32 nodeCount() const { return m_columns * m_rows; }
+
+private:
+    b2Vec2 m_origin = b2Vec2(0.0f, 0.0f);
+    float m_spacing = 1.0f;
+    int m_columns = 0;
+    int m_rows = 0;
+};
+
+#endif // LATTICEINDEX_H
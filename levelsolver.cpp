@@ -0,0 +1,264 @@
+/**
+ * This class is the level validator.
+ *
+ * It plays a level headlessly for many radio
+ * configurations at once, one simulation per
+ * configuration, and reports which ones reach a
+ * target and how quickly.
+ */
+
+#include "levelsolver.h"
+#include "wavesimulation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <thread>
+
+namespace
+{
+const char* const antennaTypes[] = {"dish", "yagi", "dipole"};
+const char* const frequencyBands[] = {"HF", "VHF", "UHF", "SHF"};
+
+const int minPower = 1;
+const int maxPower = 100;
+const int minHeight = 0;
+const int maxHeight = 30;
+const int minOrientation = -90;
+const int maxOrientation = 90;
+
+// Values from first to last spaced by step, always including last.
+std::vector<int> spacedValues(int first, int last, int step)
+{
+    std::vector<int> values;
+    for (int value = first; value < last; value += std::max(1, step)) {
+        values.push_back(value);
+    }
+    values.push_back(last);
+    return values;
+}
+}
+
+LevelSolver::LevelSolver(int levelNumber)
+    : m_levelNumber(levelNumber)
+{
+}
+
+void LevelSolver::setThreadCount(int threads)
+{
+    m_threadCount = std::max(0, threads);
+}
+
+void LevelSolver::setMaxSteps(int steps)
+{
+    m_maxSteps = std::max(1, steps);
+}
+
+void LevelSolver::setLinearPreview(bool enabled)
+{
+    m_linearPreview = enabled;
+}
+
+SweepResult LevelSolver::run(int levelNumber, const SweepConfiguration& configuration, int maxSteps)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    SweepResult result;
+    result.configuration = configuration;
+
+    // Applied in the order of the control panel.
+    WaveSimulation simulation(levelNumber);
+    simulation.setAntennaType(configuration.antennaType);
+    simulation.setFrequencyBand(configuration.frequencyBand);
+    simulation.setTransmitPower(configuration.transmitPower);
+    simulation.setAntennaHeight(configuration.antennaHeight);
+    simulation.setAntennaOrientation(configuration.orientation);
+    simulation.emitWave();
+
+    if (!simulation.getProbes().empty()) {
+        while (result.steps < maxSteps) {
+            simulation.step();
+            ++result.steps;
+            if (!simulation.getTriggeredProbes().empty()) {
+                result.solved = true;
+                break;
+            }
+        }
+    }
+
+    result.simulatedSeconds = result.steps * simulation.deltaTime;
+    result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+std::vector<SweepResult> LevelSolver::solve(const std::vector<SweepConfiguration>& configurations) const
+{
+    std::vector<SweepResult> results(configurations.size());
+    if (configurations.empty()) {
+        return results;
+    }
+    if (m_linearPreview) {
+        return preview(configurations);
+    }
+
+    int threads = m_threadCount > 0 ? m_threadCount : int(std::max(1u, std::thread::hardware_concurrency()));
+    threads = std::min(threads, int(configurations.size()));
+
+    // The first run happens here so Box2D's lazily built shared tables
+    // (contact registry, allocator lookup) exist before any worker starts.
+    results[0] = run(m_levelNumber, configurations[0], m_maxSteps);
+
+    // Runs take very different times, so workers pull the next configuration
+    // as they finish instead of owning a fixed slice.
+    std::atomic<size_t> next(1);
+    auto worker = [&]() {
+        for (size_t index = next++; index < configurations.size(); index = next++) {
+            results[index] = run(m_levelNumber, configurations[index], m_maxSteps);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+
+    return results;
+}
+
+std::vector<SweepResult> LevelSolver::preview(const std::vector<SweepConfiguration>& configurations) const
+{
+    std::vector<SweepResult> results(configurations.size());
+
+    // Cached responses depend only on the antenna position and the kick
+    // radius, that is on height and power, so each group of configurations
+    // sharing them is predicted by one worker from one set of responses.
+    std::map<std::pair<int, int>, std::vector<size_t>> groupMap;
+    for (size_t i = 0; i < configurations.size(); ++i) {
+        groupMap[std::make_pair(configurations[i].antennaHeight, configurations[i].transmitPower)].push_back(i);
+    }
+    std::vector<std::vector<size_t>> groups;
+    for (auto& group : groupMap) {
+        groups.push_back(std::move(group.second));
+    }
+
+    int threads = m_threadCount > 0 ? m_threadCount : int(std::max(1u, std::thread::hardware_concurrency()));
+    threads = std::min(threads, int(groups.size()));
+
+    // Worlds are built here, before any worker starts, for the same reason
+    // solve() plays its first run on the calling thread.
+    std::vector<std::unique_ptr<WaveSimulation>> simulations;
+    for (int i = 0; i < threads; ++i) {
+        simulations.emplace_back(new WaveSimulation(m_levelNumber));
+        simulations.back()->setPreviewThreadCount(1);
+    }
+
+    std::atomic<size_t> next(0);
+    auto worker = [&](WaveSimulation& simulation) {
+        for (size_t group = next++; group < groups.size(); group = next++) {
+            for (size_t index : groups[group]) {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                const SweepConfiguration& configuration = configurations[index];
+                SweepResult& result = results[index];
+                result.configuration = configuration;
+
+                simulation.setAntennaType(configuration.antennaType);
+                simulation.setFrequencyBand(configuration.frequencyBand);
+                simulation.setTransmitPower(configuration.transmitPower);
+                simulation.setAntennaHeight(configuration.antennaHeight);
+                simulation.setAntennaOrientation(configuration.orientation);
+
+                const std::vector<ResponsePrediction>& predictions = simulation.previewTransmission(m_maxSteps);
+                result.steps = predictions.empty() ? 0 : m_maxSteps;
+                for (const ResponsePrediction& prediction : predictions) {
+                    if (prediction.reached && prediction.step <= result.steps) {
+                        result.solved = true;
+                        result.steps = prediction.step;
+                    }
+                }
+
+                result.simulatedSeconds = result.steps * simulation.deltaTime;
+                result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(worker, std::ref(*simulations[i]));
+    }
+    worker(*simulations[0]);
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+
+    return results;
+}
+
+std::vector<SweepConfiguration> LevelSolver::fullGrid(const SweepSpacing& spacing)
+{
+    std::vector<int> powers = spacedValues(minPower, maxPower, spacing.power);
+    std::vector<int> heights = spacedValues(minHeight, maxHeight, spacing.height);
+    std::vector<int> orientations = spacedValues(minOrientation, maxOrientation, spacing.orientation);
+
+    std::vector<SweepConfiguration> configurations;
+    for (const char* antenna : antennaTypes) {
+        bool omnidirectional = std::string(antenna) == "dipole";
+        for (const char* band : frequencyBands) {
+            for (int power : powers) {
+                for (int height : heights) {
+                    if (omnidirectional) {
+                        configurations.push_back({antenna, band, power, height, 0});
+                        continue;
+                    }
+                    for (int orientation : orientations) {
+                        configurations.push_back({antenna, band, power, height, orientation});
+                    }
+                }
+            }
+        }
+    }
+    return configurations;
+}
+
+std::vector<SweepConfiguration> LevelSolver::sampledGrid(int count, unsigned seed)
+{
+    // std::mt19937 gives the same sequence on every platform; the standard
+    // distributions do not, so values are reduced by hand.
+    std::mt19937 generator(seed);
+    auto pick = [&generator](int first, int last) {
+        return first + int(generator() % unsigned(last - first + 1));
+    };
+
+    std::vector<SweepConfiguration> configurations;
+    configurations.reserve(std::max(0, count));
+    for (int i = 0; i < count; ++i) {
+        SweepConfiguration configuration;
+        configuration.antennaType = antennaTypes[pick(0, 2)];
+        configuration.frequencyBand = frequencyBands[pick(0, 3)];
+        configuration.transmitPower = pick(minPower, maxPower);
+        configuration.antennaHeight = pick(minHeight, maxHeight);
+        configuration.orientation = pick(minOrientation, maxOrientation);
+        configurations.push_back(configuration);
+    }
+    return configurations;
+}
+
+void LevelSolver::writeCsv(std::ostream& out, const std::vector<SweepResult>& results)
+{
+    out << "antenna,band,power,height,orientation,solved,steps,simulated_seconds,wall_seconds\n";
+    for (const SweepResult& result : results) {
+        const SweepConfiguration& configuration = result.configuration;
+        out << configuration.antennaType << ',' << configuration.frequencyBand << ','
+            << configuration.transmitPower << ',' << configuration.antennaHeight << ','
+            << configuration.orientation << ',' << (result.solved ? 1 : 0) << ','
+            << result.steps << ',' << result.simulatedSeconds << ',' << result.wallSeconds << '\n';
+    }
+}
@@ -0,0 +1,89 @@
+/**
+ * @file LevelSolver.h
+ * @brief This class checks which radio settings solve a level. It plays the level
+ * headlessly once per antenna configuration: the settings are applied, one wave
+ * is transmitted, and the simulation is stepped until a receiver probe at a
+ * target triggers or the step budget runs out. Every run builds its own world,
+ * so runs are independent and are spread over all cores; the results come back
+ * in the order of the configurations whatever the thread count.
+ *
+ * @author: Trentton Stratton, Phuc Hoang, Chanphone Visathip, Thu Ha.
+ * @date: 12/12/2024
+ */
+
+#ifndef LEVELSOLVER_H
+#define LEVELSOLVER_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// One combination of the player's radio controls.
+struct SweepConfiguration
+{
+    std::string antennaType;  // "dish", "yagi" or "dipole"
+    std::string frequencyBand;  // "HF", "VHF", "UHF" or "SHF"
+    int transmitPower;  // 1 to 100
+    int antennaHeight;  // 0 to 30
+    int orientation;  // -90 to 90 degrees
+};
+
+// Outcome of playing a level with one configuration.
+struct SweepResult
+{
+    SweepConfiguration configuration;
+    bool solved = false;  // Whether a target was reached within the step budget
+    int steps = 0;  // Steps until the first target was reached, or the steps taken
+    float simulatedSeconds = 0.0f;  // Simulated time matching steps
+    double wallSeconds = 0.0;  // Real time the run took
+};
+
+// Distance between neighbouring values of each control in a full sweep grid.
+struct SweepSpacing
+{
+    int power = 10;
+    int height = 5;
+    int orientation = 15;
+};
+
+// The LevelSolver class sweeps a level over a set of radio configurations.
+class LevelSolver
+{
+public:
+    explicit LevelSolver(int levelNumber);
+
+    // Sets the number of runs played at once; 0 uses every core.
+    void setThreadCount(int threads);
+    // Sets the steps a run may take before it counts as unsolved.
+    void setMaxSteps(int steps);
+    // Predicts the runs from cached grid responses instead of playing them.
+    // The results then follow the grid engine rather than the particle mesh.
+    void setLinearPreview(bool enabled);
+
+    // Plays every configuration and returns one result per configuration, in order.
+    std::vector<SweepResult> solve(const std::vector<SweepConfiguration>& configurations) const;
+
+    // Plays one configuration of a level on the calling thread.
+    static SweepResult run(int levelNumber, const SweepConfiguration& configuration, int maxSteps);
+
+    // Every antenna type and band with the other controls spaced over their
+    // ranges. The dipole is omnidirectional, so it only gets one orientation.
+    static std::vector<SweepConfiguration> fullGrid(const SweepSpacing& spacing = SweepSpacing());
+
+    // Configurations drawn uniformly from the control ranges. The same seed
+    // always gives the same configurations.
+    static std::vector<SweepConfiguration> sampledGrid(int count, unsigned seed);
+
+    // Writes the results as CSV, one line per configuration.
+    static void writeCsv(std::ostream& out, const std::vector<SweepResult>& results);
+
+private:
+    std::vector<SweepResult> preview(const std::vector<SweepConfiguration>& configurations) const;
+
+    int m_levelNumber;
+    int m_threadCount = 0;
+    int m_maxSteps = 600;  // Ten seconds of simulated time
+    bool m_linearPreview = false;
+};
+
+#endif // LEVELSOLVER_H
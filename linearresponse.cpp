@@ -0,0 +1,326 @@
+/**
+ * This class is the transmission previewer.
+ *
+ * It runs the grid medium backwards from each receiver
+ * reading once per antenna position and kick radius,
+ * bins the responses by beam angle, and answers every
+ * other question about a transmission from those sums.
+ */
+
+#include "linearresponse.h"
+#include "fdtdsolver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+// Beam angle bins. Antenna orientations are whole degrees and beam widths
+// have half-degree halves, so beam edges always fall on bin edges.
+const float binDegrees = 0.5f;
+const int binCount = 720;
+
+// Beam angle of an offset in degrees, measured like the antenna orientation:
+// 0 along +y, positive toward +x.
+float beamAngle(b2Vec2 offset)
+{
+    return std::atan2(offset.x, offset.y) * (180.0f / b2_pi);
+}
+
+int angleBin(float degrees)
+{
+    int bin = int(std::floor((degrees + 180.0f) / binDegrees));
+    return std::min(binCount - 1, std::max(0, bin));
+}
+}
+
+LinearResponse::LinearResponse(b2Vec2 lower, b2Vec2 upper, float cellSize, float dt)
+    : m_lower(lower), m_upper(upper), m_cellSize(cellSize), m_dt(dt)
+{
+    // Same grid as FdtdSolver.
+    m_columns = int((upper.x - lower.x) / cellSize) + 1;
+    m_rows = int((upper.y - lower.y) / cellSize) + 1;
+}
+
+void LinearResponse::setWaveSpeed(float speed)
+{
+    m_waveSpeed = speed;
+    clear();
+}
+
+void LinearResponse::setDamping(float damping)
+{
+    m_damping = damping;
+    clear();
+}
+
+void LinearResponse::setAbsorbingLayer(float width, float damping)
+{
+    m_layerWidth = width;
+    m_layerDamping = damping;
+    clear();
+}
+
+void LinearResponse::setHorizon(int steps)
+{
+    steps = std::max(1, steps);
+    if (steps != m_horizon) {
+        m_horizon = steps;
+        clear();
+    }
+}
+
+void LinearResponse::setThreadCount(int threads)
+{
+    m_threadCount = std::max(0, threads);
+}
+
+void LinearResponse::setCacheSize(int entries)
+{
+    m_cacheSize = std::max(1, entries);
+    while (int(m_cache.size()) > m_cacheSize) {
+        m_cache.erase(std::min_element(m_cache.begin(), m_cache.end(), [](const Basis& a, const Basis& b) {
+            return a.lastUse < b.lastUse;
+        }));
+    }
+}
+
+void LinearResponse::clear()
+{
+    m_cache.clear();
+}
+
+void LinearResponse::addSampleTaps(b2Vec2 position, float weight, std::vector<Tap>& taps) const
+{
+    // The bilinear interpolation of FdtdSolver::sample. Border nodes are
+    // always zero, so clamping to them adds nothing.
+    float x = (position.x - m_lower.x) / m_cellSize;
+    float y = (position.y - m_lower.y) / m_cellSize;
+    int column = int(std::floor(x));
+    int row = int(std::floor(y));
+    float fx = x - column;
+    float fy = y - row;
+
+    const float weights[4] = {(1.0f - fx) * (1.0f - fy), fx * (1.0f - fy), (1.0f - fx) * fy, fx * fy};
+    for (int i = 0; i < 4; ++i) {
+        int tapColumn = std::max(0, std::min(column + (i & 1), m_columns - 1));
+        int tapRow = std::max(0, std::min(row + (i >> 1), m_rows - 1));
+        if (weights[i] != 0.0f) {
+            taps.push_back({tapColumn, tapRow, weight * weights[i]});
+        }
+    }
+}
+
+void LinearResponse::setReceivers(const std::vector<std::vector<b2Vec2>>& receivers)
+{
+    m_readings.clear();
+    m_readingReceiver.clear();
+    m_receiverCount = int(receivers.size());
+
+    // FdtdSolver::displacement: central differences of two samples.
+    float scale = 1.0f / (2.0f * m_cellSize);
+    b2Vec2 dx(m_cellSize, 0.0f);
+    b2Vec2 dy(0.0f, m_cellSize);
+    for (size_t receiver = 0; receiver < receivers.size(); ++receiver) {
+        for (const b2Vec2& node : receivers[receiver]) {
+            std::vector<Tap> x;
+            addSampleTaps(node + dx, scale, x);
+            addSampleTaps(node - dx, -scale, x);
+            std::vector<Tap> y;
+            addSampleTaps(node + dy, scale, y);
+            addSampleTaps(node - dy, -scale, y);
+
+            m_readings.push_back(x);
+            m_readings.push_back(y);
+            m_readingReceiver.push_back(int(receiver));
+        }
+    }
+
+    clear();
+}
+
+const LinearResponse::Basis& LinearResponse::findBasis(b2Vec2 center, float radius)
+{
+    ++m_useCounter;
+    for (Basis& basis : m_cache) {
+        if (basis.center == center && basis.radius == radius) {
+            basis.lastUse = m_useCounter;
+            return basis;
+        }
+    }
+
+    if (int(m_cache.size()) >= m_cacheSize) {
+        m_cache.erase(std::min_element(m_cache.begin(), m_cache.end(), [](const Basis& a, const Basis& b) {
+            return a.lastUse < b.lastUse;
+        }));
+    }
+
+    m_cache.push_back(Basis());
+    Basis& basis = m_cache.back();
+    basis.center = center;
+    basis.radius = radius;
+    basis.lastUse = m_useCounter;
+    buildBasis(basis);
+    return basis;
+}
+
+void LinearResponse::buildBasis(Basis& basis)
+{
+    const int readingCount = int(m_readings.size());
+    const int horizon = m_horizon;
+    basis.prefix.assign(size_t(binCount + 1) * readingCount * horizon, 0.0f);
+    basis.centerTerm.assign(size_t(readingCount) * horizon, 0.0f);
+    if (readingCount == 0) {
+        return;
+    }
+
+    // The nodes addRadialKick can reach, with their kick weight per unit
+    // speed and their beam angle bin. Bin b is stored in row b + 1 so the
+    // running sum can be taken in place afterwards.
+    struct Source
+    {
+        int column;
+        int row;
+        float weight;
+        int bin;
+    };
+    std::vector<Source> sources;
+    float h = 0.0f;
+    {
+        FdtdSolver probe(m_lower, m_upper, m_cellSize);
+        probe.setThreadCount(1);
+        probe.setWaveSpeed(m_waveSpeed);
+        h = probe.substepLength(m_dt);
+    }
+
+    const b2Vec2 center = basis.center;
+    const float radius = basis.radius;
+    int firstColumn = std::max(1, int(std::floor((center.x - radius - m_lower.x) / m_cellSize)));
+    int lastColumn = std::min(m_columns - 2, int(std::ceil((center.x + radius - m_lower.x) / m_cellSize)));
+    int firstRow = std::max(1, int(std::floor((center.y - radius - m_lower.y) / m_cellSize)));
+    int lastRow = std::min(m_rows - 2, int(std::ceil((center.y + radius - m_lower.y) / m_cellSize)));
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            b2Vec2 offset(m_lower.x + column * m_cellSize - center.x, m_lower.y + row * m_cellSize - center.y);
+            float distance = offset.Length();
+            if (distance > radius) {
+                continue;
+            }
+            int bin = distance > 0.0f ? angleBin(beamAngle(offset)) + 1 : 0;  // 0: the center node
+            sources.push_back({column, row, (radius - distance) * h, bin});
+        }
+    }
+
+    // One backward simulation per reading: by reciprocity, the field at a
+    // source node after a kick shaped like the reading is the reading after
+    // a kick at that source node.
+    int threads = m_threadCount > 0 ? m_threadCount : int(std::max(1u, std::thread::hardware_concurrency()));
+    threads = std::min(threads, readingCount);
+
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        FdtdSolver solver(m_lower, m_upper, m_cellSize);
+        solver.setThreadCount(1);
+        solver.setWaveSpeed(m_waveSpeed);
+        solver.setDamping(m_damping);
+        solver.setAbsorbingLayer(m_layerWidth, m_layerDamping);
+
+        for (int reading = next++; reading < readingCount; reading = next++) {
+            solver.reset();
+            for (const Tap& tap : m_readings[reading]) {
+                solver.addNodeImpulse(tap.column, tap.row, tap.weight);
+            }
+
+            float* centerTerm = basis.centerTerm.data() + size_t(reading) * horizon;
+            for (int step = 0; step < horizon; ++step) {
+                solver.step(m_dt);
+                const float* field = solver.field();
+                const int stride = solver.stride();
+                for (const Source& source : sources) {
+                    float value = source.weight * field[size_t(source.row) * stride + source.column];
+                    if (source.bin == 0) {
+                        centerTerm[step] += value;
+                    } else {
+                        basis.prefix[(size_t(source.bin) * readingCount + reading) * horizon + step] += value;
+                    }
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+
+    // Running sums over the bins, so a beam is the difference of two rows.
+    const size_t row = size_t(readingCount) * horizon;
+    for (int bin = 1; bin <= binCount; ++bin) {
+        float* current = basis.prefix.data() + bin * row;
+        const float* previous = current - row;
+        for (size_t i = 0; i < row; ++i) {
+            current[i] += previous[i];
+        }
+    }
+}
+
+void LinearResponse::predict(b2Vec2 center, float radius, float speed, b2Vec2 direction, float beamWidth,
+                             float threshold, std::vector<ResponsePrediction>& predictions)
+{
+    predictions.assign(m_receiverCount, ResponsePrediction());
+    const int readingCount = int(m_readings.size());
+    if (readingCount == 0) {
+        return;
+    }
+
+    const Basis& basis = findBasis(center, radius);
+    const int horizon = m_horizon;
+    const size_t row = size_t(readingCount) * horizon;
+
+    // Bins [first, last) of the beam, wrapping around the back.
+    int first = 0;
+    int last = binCount;
+    if (beamWidth < 360.0f) {
+        float orientation = beamAngle(direction);
+        first = int(std::lround((orientation - 0.5f * beamWidth + 180.0f) / binDegrees));
+        last = int(std::lround((orientation + 0.5f * beamWidth + 180.0f) / binDegrees));
+        first = ((first % binCount) + binCount) % binCount;
+        last = ((last % binCount) + binCount) % binCount;
+    }
+
+    const float* lower = basis.prefix.data() + size_t(first) * row;
+    const float* upper = basis.prefix.data() + size_t(last) * row;
+    const float* total = basis.prefix.data() + size_t(binCount) * row;
+    const bool wraps = beamWidth < 360.0f && last <= first;
+
+    m_signals.resize(row);
+    for (size_t i = 0; i < row; ++i) {
+        float sum = wraps ? (total[i] - lower[i]) + upper[i] : upper[i] - lower[i];
+        m_signals[i] = speed * (sum + basis.centerTerm[i]);
+    }
+
+    // A receiver reads the largest displacement among its nodes.
+    for (int step = 0; step < horizon; ++step) {
+        for (int reading = 0; reading < readingCount; reading += 2) {
+            float x = m_signals[size_t(reading) * horizon + step];
+            float y = m_signals[size_t(reading + 1) * horizon + step];
+            float amplitude = std::sqrt(x * x + y * y);
+
+            ResponsePrediction& prediction = predictions[m_readingReceiver[reading / 2]];
+            if (amplitude > prediction.peakAmplitude) {
+                prediction.peakAmplitude = amplitude;
+                prediction.peakStep = step + 1;
+            }
+            if (!prediction.reached && amplitude >= threshold) {
+                prediction.reached = true;
+                prediction.step = step + 1;
+            }
+        }
+    }
+}
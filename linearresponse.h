@@ -0,0 +1,133 @@
+/**
+ * @file LinearResponse.h
+ * @brief This class predicts what a transmission will do at the receivers without
+ * simulating it. The grid medium is linear, so the receiver signals are a sum of
+ * the kicked nodes' impulse responses weighted by the kick. By reciprocity the
+ * response at a receiver to an impulse at node s equals the response at s to an
+ * impulse at the receiver, so one simulation per receiver reading gives the
+ * responses to every possible source node at once. They are summed per beam angle
+ * around the antenna and cached, after which any orientation, beam width and kick
+ * strength is evaluated with a handful of vector subtractions.
+ *
+ * @author: Trentton Stratton, Phuc Hoang, Chanphone Visathip, Thu Ha.
+ * @date: 12/12/2024
+ */
+
+#ifndef LINEARRESPONSE_H
+#define LINEARRESPONSE_H
+
+#include <vector>
+#include "Box2D/Common/b2Math.h"
+
+// What a transmission does at one receiver.
+struct ResponsePrediction
+{
+    bool reached = false;  // Whether the amplitude crosses the threshold within the horizon
+    int step = 0;  // Step at which it first does, counted from 1
+    float peakAmplitude = 0.0f;  // Largest amplitude within the horizon
+    int peakStep = 0;  // Step of the largest amplitude
+};
+
+// The LinearResponse class caches the receiver responses of the grid medium.
+class LinearResponse
+{
+public:
+    /**
+     * Describes the grid medium, which must match the FdtdSolver it stands in for.
+     * @param lower The world position of the first grid node.
+     * @param upper The world position of the last grid node.
+     * @param cellSize The distance between neighbouring grid nodes.
+     * @param dt The length of one simulation step.
+     */
+    LinearResponse(b2Vec2 lower, b2Vec2 upper, float cellSize, float dt);
+
+    // Medium properties, as in FdtdSolver. Changing them empties the cache.
+    void setWaveSpeed(float speed);
+    void setDamping(float damping);
+    void setAbsorbingLayer(float width, float damping);
+
+    // Sets the number of steps predicted. Changing it empties the cache.
+    void setHorizon(int steps);
+    int horizon() const { return m_horizon; }
+
+    // Sets the number of threads used to build a response; 0 uses every core.
+    void setThreadCount(int threads);
+    // Sets the number of antenna positions and radii kept in the cache.
+    void setCacheSize(int entries);
+
+    /**
+     * Sets the receivers. A receiver reads the largest displacement of its
+     * nodes, like a ReceiverProbe. Changing them empties the cache.
+     * @param receivers The world positions of the nodes of each receiver.
+     */
+    void setReceivers(const std::vector<std::vector<b2Vec2>>& receivers);
+
+    /**
+     * Predicts the receiver amplitudes after a FdtdSolver::addRadialKick. Only
+     * a change of center or radius needs new simulations.
+     * @param center The center of the kick.
+     * @param radius The radius of the kicked disc.
+     * @param speed The displacement speed of the kicked nodes.
+     * @param direction The beam direction, a unit vector.
+     * @param beamWidth The beam width in degrees; 360 or more kicks the whole disc.
+     * @param threshold The amplitude a receiver must reach.
+     * @param predictions One prediction per receiver.
+     */
+    void predict(b2Vec2 center, float radius, float speed, b2Vec2 direction, float beamWidth,
+                 float threshold, std::vector<ResponsePrediction>& predictions);
+
+    // Drops every cached response.
+    void clear();
+
+private:
+    // Grid node weight of a linear reading of the field.
+    struct Tap
+    {
+        int column;
+        int row;
+        float weight;
+    };
+
+    // Responses of every reading to kicks around one antenna position.
+    struct Basis
+    {
+        b2Vec2 center{0.0f, 0.0f};
+        float radius = 0.0f;
+        unsigned lastUse = 0;
+        // Running sums over the beam angle bins: entry (bin * readings + reading) * horizon + step.
+        std::vector<float> prefix;
+        // Response to the node under the antenna, which every beam kicks.
+        std::vector<float> centerTerm;
+    };
+
+    const Basis& findBasis(b2Vec2 center, float radius);
+    void buildBasis(Basis& basis);
+    void addSampleTaps(b2Vec2 position, float weight, std::vector<Tap>& taps) const;
+
+    b2Vec2 m_lower;
+    b2Vec2 m_upper;
+    float m_cellSize;
+    int m_columns;
+    int m_rows;
+    float m_dt;
+    float m_waveSpeed = 300.0f;
+    float m_damping = 0.2f;
+    float m_layerWidth = 0.0f;
+    float m_layerDamping = 0.0f;
+    int m_horizon = 600;
+    int m_threadCount = 0;
+    int m_cacheSize = 4;
+
+    // Two readings (x and y displacement) per receiver node.
+    std::vector<std::vector<Tap>> m_readings;
+    std::vector<int> m_readingReceiver;  // Receiver of each pair of readings
+    int m_receiverCount = 0;
+
+    std::vector<Basis> m_cache;
+    unsigned m_useCounter = 0;
+
+    // Scratch space of predict, kept between calls.
+    std::vector<float> m_signals;
+};
+
+#endif // LINEARRESPONSE_H
@@ -1,80 +1,150 @@
 #include <QApplication>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
 #include "GUI.h"
+#include "inputlog.h"
+#include "levelsolver.h"
 #include "model.h"
 
 int main(int argc, char *argv[])
 {
+    // radioApp --sweep <level> [samples [seed]] checks a level headlessly over
+    // the radio settings and prints the results as CSV. Without a sample count
+    // the full grid is played. --preview-sweep predicts the runs instead.
+    bool previewSweep = argc >= 3 && std::strcmp(argv[1], "--preview-sweep") == 0;
+    if (argc >= 3 && (std::strcmp(argv[1], "--sweep") == 0 || previewSweep)) {
+        int levelNumber = std::atoi(argv[2]);
+        int samples = argc >= 4 ? std::atoi(argv[3]) : 0;
+        unsigned seed = argc >= 5 ? unsigned(std::strtoul(argv[4], nullptr, 10)) : 1u;
+
+        LevelSolver solver(levelNumber);
+        solver.setLinearPreview(previewSweep);
+        std::vector<SweepConfiguration> configurations =
+            samples > 0 ? LevelSolver::sampledGrid(samples, seed) : LevelSolver::fullGrid();
+        LevelSolver::writeCsv(std::cout, solver.solve(configurations));
+        return 0;
+    }
+
+    // radioApp --replay <log> plays a recorded session headlessly at full
+    // speed and reports its timing and whether it ended in the recorded state.
+    if (argc >= 3 && std::strcmp(argv[1], "--replay") == 0) {
+        InputLog log;
+        if (!log.load(argv[2])) {
+            std::cerr << "Cannot read " << argv[2] << '\n';
+            return 1;
+        }
+        ReplayResult replay = log.replay();
+        std::cout << "steps " << replay.steps << '\n'
+                  << "wall_seconds " << replay.wallSeconds << '\n'
+                  << "steps_per_second " << (replay.wallSeconds > 0.0 ? replay.steps / replay.wallSeconds : 0.0) << '\n'
+                  << "state_hash " << std::hex << replay.stateHash << std::dec << '\n'
+                  << "verified " << (replay.verified ? "yes" : "no") << '\n';
+        for (const auto& slow : replay.slowestSteps) {
+            std::cout << "slow_step " << slow.second << ' ' << slow.first * 1000.0 << " ms\n";
+        }
+        return replay.verified ? 0 : 2;
+    }
+
+    // radioApp --record <log> plays normally and records the session;
+    // --trajectory <file> also writes the wave state of every step, and
+    // --antialias draws the particles smoothly instead of fast.
+    const char* recordPath = nullptr;
+    const char* trajectoryPath = nullptr;
+    bool antialias = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--antialias") == 0) {
+            antialias = true;
+        }
+    }
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--record") == 0) {
+            recordPath = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--trajectory") == 0) {
+            trajectoryPath = argv[i + 1];
+        }
+    }
+
     QApplication app(argc, argv);
 
     MainWindow gui;
+    if (antialias) {
+        gui.setParticleQuality(Environment::ParticleQuality::Antialiased);
+    }
     Model* model = nullptr;
     QTimer timer;
+    QElapsedTimer frameClock;  // Real time between timer ticks
 
     // Display the game menu initially
     gui.displayGameMenu();
 
+    // Show the latest results of the simulation thread at every tick
+    QObject::connect(&timer, &QTimer::timeout, [&]() {
+        if (model) {
+            model->advance(frameClock.restart() / 1000.0f);
+        }
+    });
+
     // Start Level
     QObject::connect(&gui, &MainWindow::startLevelClicked, [&](int levelNumber) {
-        // Clean up the previous model
         if (model) {
-            delete model;
-            model = nullptr;
-        }
+            // Reuse the world and the mesh, only swapping the level objects
+            model->resetLevel(levelNumber);
+        } else {
+            // The model is built once, on the first level, and kept from then on
+            model = new Model(levelNumber);
+            if (recordPath) {
+                model->startRecording(recordPath);
+            }
+            if (trajectoryPath) {
+                model->startTrajectory(trajectoryPath);
+            }
 
-        // Create and set up a new model
-        model = new Model(levelNumber);
+            // Connect model updates to GUI
+            gui.setWaveLattice(model->getLatticeIndex());
+            QObject::connect(model, &Model::updateParticlePositions, [&gui](const ParticleFrame& frame, float alpha) {
+                gui.displayLevel(frame.previousPositions, frame.positions, alpha);
+            });
+
+            QObject::connect(model, &Model::updateObjectsPositions, [&gui](const QVector<ObjectData>& objects) {
+                gui.displayLevelObjects(objects);
+            });
+
+            QObject::connect(model, &Model::updateCoverage, &gui, &MainWindow::displayCoverage);
+
+            // Connect GUI controls to the model
+            QObject::connect(&gui, &MainWindow::antennaTypeSelected, model, &Model::setAntennaType);
+            QObject::connect(&gui, &MainWindow::antennaOrientationAdjusted, model, &Model::setAntennaOrientation);
+            QObject::connect(&gui, &MainWindow::frequencyBandSelected, model, &Model::setFrequencyBand);
+            QObject::connect(&gui, &MainWindow::powerLevelAdjusted, model, &Model::setTransmitPower);
+            QObject::connect(&gui, &MainWindow::antennaHeightAdjusted, model, &Model::setAntennaHeight);
+            QObject::connect(&gui, &MainWindow::propagationModeSelected, model, &Model::setPropagationMode);
+            QObject::connect(&gui, &MainWindow::transmitButtonClicked, model, &Model::emitWave);
+            QObject::connect(&gui, &MainWindow::continuousWaveToggled, model, &Model::setContinuousWave);
+            QObject::connect(&gui, &MainWindow::coverageToggled, model, &Model::setCoverageVisible);
+
+            // Handle human touched event
+            QObject::connect(model, &Model::humanTouched, [&](int levelNumber) {
+                gui.displayLevelCompleteWindow(levelNumber);
+                timer.stop();
+                model->setRunning(false);
+
+                // Build the next level while the completion page is up
+                if (levelNumber < 5) {
+                    model->preloadLevel(levelNumber + 1);
+                }
+            });
+        }
 
         // Set up the GUI for the new level
         gui.setupLevel(levelNumber);
 
-        // Start the timer for updating the model
+        // Start the simulation and the timer for updating the view
+        model->setRunning(true);
         timer.start(16);
-
-        // Connect timer to model's step function
-        QObject::connect(&timer, &QTimer::timeout, [&]() {
-            if (model) {
-                model->step();
-            }
-        });
-
-        // Connect model updates to GUI
-        QObject::connect(model, &Model::updateParticlePositions, [&gui](const QVector<b2Vec2>& positions) {
-            gui.displayLevel(positions);
-        });
-
-        QObject::connect(model, &Model::updateObjectsPositions, [&gui](const QVector<ObjectData>& objects) {
-            gui.displayLevelObjects(objects);
-        });
-
-        // Connect GUI controls to the model
-        QObject::connect(&gui, &MainWindow::antennaTypeSelected, [=](const QString& selectedAntenna) {
-            model->setAntennaType(selectedAntenna);
-        });
-
-        QObject::connect(&gui, &MainWindow::antennaOrientationAdjusted, [=](int selectedAntennaOrientation) {
-            model->setAntennaOrientation(selectedAntennaOrientation);
-        });
-
-        QObject::connect(&gui, &MainWindow::frequencyBandSelected, [=](const QString& selectedFrequencyBand) {
-            model->setFrequencyBand(selectedFrequencyBand);
-        });
-
-        QObject::connect(&gui, &MainWindow::powerLevelAdjusted, [=](int selectedPowerLevel) {
-            model->setTransmitPower(selectedPowerLevel);
-        });
-
-        QObject::connect(&gui, &MainWindow::antennaHeightAdjusted, [=](int selectedAntennaHeight) {
-            model->setAntennaHeight(selectedAntennaHeight);
-        });
-
-        QObject::connect(&gui, &MainWindow::transmitButtonClicked, model, &Model::emitWave);
-
-        // Handle human touched event
-        QObject::connect(model, &Model::humanTouched, [&](int levelNumber) {
-            gui.displayLevelCompleteWindow(levelNumber);
-            timer.stop();
-        });
+        frameClock.start();
     });
 
     // Handle level complete transition
@@ -92,13 +162,10 @@ int main(int argc, char *argv[])
 
     // Reset to the main menu on exit
     QObject::connect(&gui, &MainWindow::exitToMenu, [&]() {
-        // Stop the timer
+        // Stop the timer; the model is kept for the next level
         timer.stop();
-
-        // Delete the current model
         if (model) {
-            delete model;
-            model = nullptr;
+            model->setRunning(false);
         }
 
         // Reset the GUI to the main menu
@@ -106,5 +173,7 @@ int main(int argc, char *argv[])
     });
 
     gui.show();
-    return app.exec();
+    int result = app.exec();
+    delete model;
+    return result;
 }
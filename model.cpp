@@ -1,602 +1,366 @@
 /**
  * This class is the model for the app.
  *
- * It is responsible for creating the elements of the
- * game and determining their position at each step in
- * time. Additionally, it responds to user controls to
- * modify the properties of some objects in order to
- * alter how the radio wave propagates through the medium.
- *
- * Game elements include the player avatar, target avatar,
- * ground, sky, obstacles, and a mesh of particles (which is
- * the medium by which the wave propagation is visualized).
+ * It runs the simulation engine (wavesimulation.cpp)
+ * on its own thread, queueing the user controls to it
+ * and publishing the resulting positions of the game
+ * elements to the view from the GUI thread.
  */
 
 #include "model.h"
 
-void Model::setUpLevel(Model::LevelWorlds level)
-{
-    for (const ObjectData& obj : level.getObjects())
-    {
-        switch (obj.type)
-        {
-        case ObjectType::Rock:
-            addRock(obj.objPos);
-            break;
-        case ObjectType::Tree:
-            addTree(obj.objPos);
-            break;
-        case ObjectType::Hill:
-            addHill(obj.objPos);
-            break;
-        case ObjectType::Human:
-            addHuman(obj.objPos);
-            if (playerLocation.x == 0.0f) {  // Set playerLocation.x to the first human's position
-                playerLocation.x = obj.objPos.x;
-                playerLocation.y = obj.objPos.y;
-            }
-            break;
-        default:
-            break;
-        }
-    }
-}
+#include <algorithm>
 
 Model::Model(int levelNumber)
+    : simulation(levelNumber), initialLevel(levelNumber)
 {
-    windowWidth = 1200;
-    windowHeight = 800;
-
-    b2Vec2 gravity(0.0, 0.0);
-    world = new b2World(gravity);
-    deltaTime = 1.0f / 60.0f; // 60 FPS
-
-    addGround(b2Vec2(0.0f, 850.0f));
-    addParticleMesh(20, 1, windowWidth, windowHeight); // 10, 1
-
-    // switch statement for level objects to add
     qDebug() <<"in model: " <<levelNumber;
-    m_levelNumber = levelNumber;
-    switch(levelNumber)
-    {
-        case 1:
-        {
-            Model::LevelWorlds level = LevelWorlds::createLevel1();
-            setUpLevel(level);
-            break;
-        }
-        case 2:
-        {
-            Model::LevelWorlds level = LevelWorlds::createLevel2();
-            setUpLevel(level);
-            break;
-        }
-        case 3:
-        {
-            Model::LevelWorlds level = LevelWorlds::createLevel3();
-            setUpLevel(level);
-            break;
-        }
-        case 4:
-        {
-            Model::LevelWorlds level = LevelWorlds::createLevel4();
-            setUpLevel(level);
-            break;
-        }
-        case 5:
-        {
-            Model::LevelWorlds level = LevelWorlds::createLevel5();
-            setUpLevel(level);
-            break;
-        }
-    }
-    playerLocation = b2Vec2(400.0f, 500.0f); // kind of arbitrary player position
-    transmitLocation = b2Vec2(playerLocation.x, playerLocation.y - 5 * 10);
-}
+    qDebug() << "Width:" << simulation.windowWidth << "height" << simulation.windowHeight;
+    qDebug() << simulation.getParticleFrame().positions.size();
 
+    // The thread starts later; until then this thread stands in for it.
+    publishStatus();
+    status = &statusBuffer.read();
+}
 
 Model::~Model()
 {
-    delete world;
+    quit = true;
+    if (worker.joinable()) {
+        worker.join();
+    }
+    recorder.close(simulation.getStepIndex(), simulation.getStateHash());
 }
 
-void Model::getPosition()
+bool Model::startRecording(const QString& path)
 {
-    QVector<b2Vec2> position;
-    for (auto body : particleMesh)
-    {
-        position.append(body->GetPosition());
+    // Replays start from a fresh simulation, so the log has to as well.
+    if (worker.joinable() || simulation.getStepIndex() != 0 || !recorder.open(path.toStdString(), initialLevel)) {
+        qDebug() << "Cannot record to" << path;
+        return false;
     }
-    emit updateParticlePositions(position);
+    return true;
 }
 
-void Model::getObjectPosition()
+bool Model::startTrajectory(const QString& path)
 {
-    emit updateObjectsPositions(levelItems);
+    if (worker.joinable() || !simulation.startTrajectory(path.toStdString())) {
+        qDebug() << "Cannot write trajectory to" << path;
+        return false;
+    }
+    return true;
 }
 
-
-void Model::addParticleMesh(int particleSpacing, int particleSize, int windowWidth, int windowHeight)
+void Model::setRunning(bool enabled)
 {
-
-    for (int y = 0; y <= windowHeight; y += particleSpacing)
-    {
-        for (int x = -200; x <= windowWidth + 200; x += particleSpacing)
-        {
-            b2Vec2 position(x,y);
-            b2Body* particle = addParticle(position, particleSize);
-
-            // create distance joints to particle to left (in -x direction)
-            if (x > -200)
-            {
-                b2Body* particleLeft = particleMesh.back();
-                createParticleMeshJoint(particleLeft, particle, particleSpacing);
-            }
-
-            // create distance joints to particle in row above (in -y direction)
-            if (y > 0)
-            {
-                b2Body* particleAbove = particleMesh[particleMesh.size() - ((windowWidth+400) / particleSpacing) - 1];
-                createParticleMeshJoint(particleAbove, particle, particleSpacing);
-            }
-
-            // create distance joints to particle above and to left (in -y direction and -x direction)
-            if (x > 1 && y > 1)
-            {
-                b2Body* particleDiagonal = particleMesh[particleMesh.size() - ((windowWidth+400) / particleSpacing) - 2];
-
-                int diagParticleSpacing = sqrt(2 * (particleSpacing * particleSpacing)); // pythag thrm
-                createParticleMeshJoint(particleDiagonal, particle, diagParticleSpacing);
-            }
-
-            particleMesh.append(particle);
-        }
+    running = enabled;
+    if (enabled && !worker.joinable()) {
+        worker = std::thread(&Model::run, this);
     }
-    qDebug() << "Width:" << windowWidth << "height" << windowHeight;
-    qDebug() << particleMesh.size();
-    getPosition();
 }
 
-
-b2Body* Model::addParticle(b2Vec2 position, int particleSize)
+void Model::sendCommand(const InputEvent& command)
 {
+    preloadedLevel = 0;
 
-    // define body
-    b2BodyDef particleDef;
-    particleDef.position.Set(position.x, position.y);
-
-    if ((position.y > 0 && position.y < windowHeight) && (position.x > -200 && position.x < windowWidth + 200))
-    {
-        particleDef.type = b2_dynamicBody;
-    }
-    else
-    {
-        particleDef.type = b2_staticBody;
+    // Commands that found the queue full go first, keeping the order.
+    flushCommands();
+    if (!overflow.empty() || !commands.push(command)) {
+        overflow.push_back(command);
     }
-
-    // create body
-    b2Body* particleBody = world->CreateBody(&particleDef);
-
-    // shape
-    b2CircleShape particleShape;
-    particleShape.m_radius = particleSize / 2.0f;
-
-
-    // fixture
-    b2FixtureDef fixtureDef;
-    fixtureDef.shape = &particleShape;
-
-    if (particleDef.type == b2_dynamicBody)
-    {
-        // dynamic fixture properties
-        fixtureDef.density = 1.0f;     // weight
-        fixtureDef.friction =0.01f;    //.1
-        fixtureDef.restitution = 10000.0f; //.5
-    }
-
-    particleBody->CreateFixture(&fixtureDef);
-    return particleBody;
 }
 
-
-void Model::createParticleMeshJoint(b2Body* bodyA, b2Body* bodyB, int particleSpacing)
+void Model::flushCommands()
 {
-    b2DistanceJointDef jointDef;
-    jointDef.bodyA = bodyA;
-    jointDef.bodyB = bodyB;
-    jointDef.collideConnected = false; // prevent collision between connected bodies
-    jointDef.length = particleSpacing;
-    jointDef.frequencyHz = 2.5f;       // stiffness 10
-    jointDef.dampingRatio = .1f;       // damping   5
-
-    world->CreateJoint(&jointDef);
+    size_t sent = 0;
+    while (sent < overflow.size() && commands.push(overflow[sent])) {
+        ++sent;
+    }
+    overflow.erase(overflow.begin(), overflow.begin() + sent);
 }
 
-
-b2Body* Model::addSky(b2Vec2 position)
+void Model::run()
 {
-    b2BodyDef skyDef;
-    skyDef.type = b2_staticBody;
-    skyDef.position.Set(position.x, position.y);
-
-    b2Body* skyBody = world->CreateBody(&skyDef);
-
-    b2PolygonShape skyBox;
-    skyBox.SetAsBox(1200.0f, 50.0f);
-
-    skyBody->CreateFixture(&skyBox, 0.0f);
+    std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+    while (!quit) {
+        applyCommands();
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        float elapsedSeconds = std::chrono::duration<float>(now - last).count();
+        last = now;
+
+        // A receiver probe at a human target saw the wave arrive.
+        bool touched = false;
+        if (running) {
+            simulation.advance(elapsedSeconds);
+            touched = !simulation.getTriggeredProbes().empty();
+        }
+        for (; stepRequests > 0; --stepRequests) {
+            simulation.step();
+            touched = touched || !simulation.getTriggeredProbes().empty();
+        }
+        if (touched) {
+            ++touchCount;
+        }
+        publishStatus();
 
-    return skyBody;
+        // Sleep until the next step is due; while paused, only wake up to
+        // pick up commands.
+        float wait = simulation.deltaTime;
+        if (running) {
+            wait *= 1.0f - simulation.getInterpolationAlpha();
+        }
+        std::this_thread::sleep_for(std::chrono::duration<float>(wait));
+    }
 }
 
-
-b2Body* Model::addGround(b2Vec2 position)
+void Model::applyCommands()
 {
-    b2BodyDef groundDef;
-    groundDef.type = b2_staticBody;
-    groundDef.position.Set(position.x, position.y);
-
-    b2Body* groundBody = world->CreateBody(&groundDef);
-
-    b2PolygonShape groundBox;
-    groundBox.SetAsBox(1200.0f, 50.0f);
+    InputEvent command;
+    while (commands.pop(command)) {
+        pending.push_back(std::move(command));
+    }
 
-    groundBody->CreateFixture(&groundBox, 0.0f);
+    // A dial dragged between two steps sends a burst of values. Only the
+    // last value of each control before the next transmission or level
+    // change can have an effect, so the earlier ones are dropped.
+    unsigned seen = 0;  // One bit per control
+    for (size_t i = pending.size(); i-- > 0;) {
+        InputCommand type = pending[i].command;
+        if (type == InputCommand::EmitWave || type == InputCommand::ResetLevel) {
+            seen = 0;
+            continue;
+        }
+        unsigned bit = 1u << unsigned(type);
+        if (seen & bit) {
+            pending[i].command = InputCommand::End;  // Superseded
+        }
+        seen |= bit;
+    }
 
-    return groundBody;
+    for (const InputEvent& next : pending) {
+        if (next.command != InputCommand::End) {
+            applyCommand(next);
+        }
+    }
+    pending.clear();
 }
 
-b2Body* Model::addRock(b2Vec2 position)
+void Model::applyCommand(const InputEvent& command)
 {
-    b2BodyDef rockBody;
-    rockBody.type = b2_staticBody;
-    rockBody.position.Set(position.x, position.y);
-
-    b2Body* rockBd = world->CreateBody(&rockBody);
-
-    b2PolygonShape rockBox;
-    rockBox.SetAsBox(90.0f, 50.0f);
+    recorder.record(simulation.getStepIndex(), command);
+    applyInputEvent(simulation, command);
 
-    b2FixtureDef fixture;
-    fixture.shape = &rockBox;
-    fixture.density = 0.0f;
-    fixture.friction = 0.8f;
-    fixture.restitution = 0.1f;
-    rockBd->CreateFixture(&fixture);
-
-    b2Vec2 rockPos = rockBd->GetPosition();
-    levelItems.push_back(ObjectData(rockPos,ObjectType::Rock));
-
-    levelObjects.push_back(rockBd);
-
-    return rockBd;
+    switch (command.command) {
+    case InputCommand::ResetLevel:
+        layoutChanged = true;
+        break;
+    case InputCommand::FrequencyBand:
+        qDebug() << "Frequency band changed. Wave speed is: " << simulation.waveSpeed;
+        break;
+    case InputCommand::AntennaType:
+        qDebug() << "Antenna type changed to:" << QString::fromStdString(command.text) << ". Beam width:" << simulation.beamWidth << ", Wave speed:" << simulation.waveSpeed;
+        break;
+    case InputCommand::EmitWave:
+        qDebug() << "Wave emitted with beam width:" << simulation.beamWidth << "and speed:" << simulation.waveSpeed << "and power:" << simulation.transmitPower;
+        break;
+    default:
+        break;
+    }
 }
 
-b2Body* Model::addTree(b2Vec2 position)
+void Model::publishStatus()
 {
-    b2BodyDef treeBody;
-    treeBody.type = b2_staticBody;
-    treeBody.position.Set(position.x, position.y);
+    ModelStatus& next = statusBuffer.writeSlot();
 
-    b2Body* treeBd = world->CreateBody(&treeBody);
-
-    b2PolygonShape treeBox;
-    treeBox.SetAsBox(90.0f, 70.0f);
-
-    b2FixtureDef fixture;
-    fixture.shape = &treeBox;
-    fixture.density = 0.0f;
-    fixture.friction = 0.8f;
-    fixture.restitution = 0.1f;
-    treeBd->CreateFixture(&fixture);
-
-    b2Vec2 treePos = treeBd->GetPosition();
-    levelItems.push_back(ObjectData(treePos,ObjectType::Tree));
-
-    levelObjects.push_back(treeBd);
+    // The objects do not move, so they are only copied when the level changes.
+    if (layoutChanged) {
+        layoutChanged = false;
+        levelItems = std::make_shared<const std::vector<ObjectData>>(simulation.getLevelItems());
+    }
+    next.levelItems = levelItems;
+    next.levelNumber = simulation.getLevelNumber();
+    next.touchCount = touchCount;
+    next.alpha = simulation.getInterpolationAlpha();
+    next.time = std::chrono::steady_clock::now();
+
+    // The map is only recomputed, and only copied for the view, when a
+    // setting it depends on has changed.
+    if (coverageVisible) {
+        const CoverageMap& map = simulation.getCoverage();
+        if (!coverage || map.revision() != publishedCoverage) {
+            publishedCoverage = map.revision();
+            coverage = std::make_shared<const CoverageMap>(map);
+        }
+    }
+    next.coverage = coverage;
 
-    return treeBd;
+    statusBuffer.publish();
 }
 
-b2Body* Model::addHill(b2Vec2 position)
+void Model::resetLevel(int levelNumber)
 {
-    b2BodyDef hillBody;
-    hillBody.type = b2_staticBody;
-    hillBody.position.Set(position.x, position.y);
-
-    b2Body* hillBd = world->CreateBody(&hillBody);
-
-    b2PolygonShape hillBox;
-    hillBox.SetAsBox(0.0f, 0.0f);
-
-    b2FixtureDef fixture;
-    fixture.shape = &hillBox;
-    fixture.density = 0.0f;
-    fixture.friction = 0.8f;
-    fixture.restitution = 0.1f;
-    hillBd->CreateFixture(&fixture);
+    shownLevelItems.reset();  // The view clears its objects on a level start
 
-    b2Vec2 hillPos = hillBd->GetPosition();
-    levelItems.push_back(ObjectData(hillPos,ObjectType::Hill));
+    // The level is already built and nothing has touched it since.
+    if (levelNumber == preloadedLevel) {
+        preloadedLevel = 0;
+        return;
+    }
 
-    levelObjects.push_back(hillBd);
-    return hillBd;
+    InputEvent command;
+    command.command = InputCommand::ResetLevel;
+    command.value = levelNumber;
+    sendCommand(command);
 }
 
-b2Body* Model::addHuman(b2Vec2 position)
+void Model::preloadLevel(int levelNumber)
 {
-    b2BodyDef humanBody;
-    humanBody.type = b2_staticBody;
-    humanBody.position.Set(position.x, position.y);
-
-    b2Body* humanBd = world->CreateBody(&humanBody);
+    // Resetting is all a level change does, and the simulation thread
+    // applies commands in order before it steps again, so the level is
+    // ready by the time the model runs.
+    resetLevel(levelNumber);
+    preloadedLevel = levelNumber;
+}
 
-    b2PolygonShape humanBox;
-    humanBox.SetAsBox(50.0f, 40.0f);
+void Model::getPosition(float alpha)
+{
+    // The frame is passed by reference: the view reads the simulation's
+    // snapshot buffer directly instead of receiving a copy every step.
+    emit updateParticlePositions(simulation.getParticleFrame(), alpha);
+}
 
-    b2FixtureDef fixture;
-    fixture.shape = &humanBox;
-    fixture.density = 0.0f;
-    fixture.friction = 0.8f;
-    fixture.restitution = 0.1f;
-    humanBd->CreateFixture(&fixture);
+void Model::getObjectPosition()
+{
+    if (status->levelItems == shownLevelItems) {
+        return;
+    }
+    shownLevelItems = status->levelItems;
+    const std::vector<ObjectData>& items = *shownLevelItems;
+    emit updateObjectsPositions(QVector<ObjectData>(items.begin(), items.end()));
+}
 
-    b2Vec2 humanPos = humanBd->GetPosition();
-    levelItems.push_back(ObjectData(humanPos,ObjectType::Human));
+void Model::getCoverage()
+{
+    if (!coverageVisible || !status->coverage || status->coverage == shownCoverage) {
+        return;
+    }
+    shownCoverage = status->coverage;
+    emit updateCoverage(*shownCoverage);
+}
 
-    levelObjects.push_back(humanBd);
+QVector<int> Model::calculateClosestParticles(b2Vec2 point, int count)
+{
+    // The lattice never changes after construction and its queries keep no
+    // shared scratch space, so this is safe to ask from any thread while the
+    // simulation thread runs.
+    std::vector<int32> particles;
+    simulation.findClosestParticles(point, count, particles);
+    return QVector<int>(particles.begin(), particles.end());
+}
 
-    return humanBd;
+const LatticeIndex& Model::getLatticeIndex() const
+{
+    return simulation.getLatticeIndex();
 }
 
 void Model::step()
 {
-    world->Step(deltaTime, 6, 2);
-    getPosition();
-    getObjectPosition();
+    ++stepRequests;
 }
 
-void Model::deleteAddedObjects()
+void Model::advance(float)
 {
-    for (b2Body* body : levelObjects)
-    {
-        world->DestroyBody(body);
+    flushCommands();
+    status = &statusBuffer.read();
+
+    // Blend toward the next step by the time passed since the status was
+    // published, as the simulation thread's accumulator has meanwhile.
+    float sincePublished = std::chrono::duration<float>(std::chrono::steady_clock::now() - status->time).count();
+    getPosition(std::min(1.0f, status->alpha + sincePublished / simulation.deltaTime));
+    getObjectPosition();
+    getCoverage();
+
+    if (status->touchCount != seenTouchCount) {
+        seenTouchCount = status->touchCount;
+        emit humanTouched(status->levelNumber);
     }
-    levelItems.clear();
 }
 
 void Model::setAntennaHeight(int height)
 {
-    antennaHeight = height;
-    setAntennaLocation(antennaHeight);
-}
-
-void Model::setAntennaLocation(int antennaHeight)
-{
-    transmitLocation = b2Vec2(playerLocation.x, playerLocation.y - antennaHeight * 10);
+    InputEvent command;
+    command.command = InputCommand::AntennaHeight;
+    command.value = height;
+    sendCommand(command);
 }
 
 void Model::setTransmitPower(int powerLevel)
 {
-    transmitPower = powerLevel;
+    InputEvent command;
+    command.command = InputCommand::TransmitPower;
+    command.value = powerLevel;
+    sendCommand(command);
 }
 
 void Model::setFrequencyBand(QString frequency)
 {
-    if (frequency == "HF") {
-        waveSpeed = 1.0;  // Low frequency, slower wave propagation
-    } else if (frequency == "VHF") {
-        waveSpeed = 2.0;  // Moderate speed
-    } else if (frequency == "UHF") {
-        waveSpeed = 3.0;  // High speed
-    } else if (frequency == "SHF") {
-        waveSpeed = 4.0;  // Very high speed
-    }
-
-    qDebug() << "Frequency band changed. Wave speed is: " << waveSpeed;
+    InputEvent command;
+    command.command = InputCommand::FrequencyBand;
+    command.text = frequency.toStdString();
+    sendCommand(command);
 }
 
 void Model::setAntennaType(QString antenna)
 {
-    if (antenna == "dish") {
-        beamWidth = 10;   // Narrow beam
-        waveSpeed = 30.0; // High speed for long-range
-    } else if (antenna == "yagi") {
-        beamWidth = 45;   // Moderate beam
-        waveSpeed = 20.0; // Medium speed for mid-range
-    } else if (antenna == "dipole") {
-        beamWidth = 360;  // Omnidirectional
-        waveSpeed = 10.0; // Low speed for short-range
-    }
-
-    qDebug() << "Antenna type changed to:" << antenna << ". Beam width:" << beamWidth << ", Wave speed:" << waveSpeed;
+    InputEvent command;
+    command.command = InputCommand::AntennaType;
+    command.text = antenna.toStdString();
+    sendCommand(command);
 }
 
 void Model::setAntennaOrientation(int angleDegrees)
 {
-    float angleRadians = angleDegrees * (M_PI / 180.0f);
-
-    float x = std::sin(angleRadians);
-    float y = std::cos(angleRadians);
-
-    transmitDirection = b2Vec2(x, y);
+    InputEvent command;
+    command.command = InputCommand::AntennaOrientation;
+    command.value = angleDegrees;
+    sendCommand(command);
 }
 
-void Model::emitWave()
+void Model::setPropagationMode(QString mode)
 {
-    // Adjust radius based on power level
-    int baseRadius = 50; // Base range of the wave
-    int radius = baseRadius + (transmitPower * 2); // Increase range with power
-
-    b2AABB aabb;
-    aabb.lowerBound = transmitLocation - b2Vec2(radius, radius);
-    aabb.upperBound = transmitLocation + b2Vec2(radius, radius);
-
-    Model::ParticleQueryCallback callback;
-    this->world->QueryAABB(&callback, aabb);
-
-    for (b2Body* particle : callback.nearbyBodies)
-    {
-        b2Vec2 particlePosition = particle->GetPosition();
-        b2Vec2 direction = particlePosition - transmitLocation;
-
-        if (direction.LengthSquared() <= radius * radius) {
-            direction.Normalize();
-
-            // Check if the particle is within the beam width
-            float angleCos = b2Dot(transmitDirection, direction);
-            float halfBeamWidthCos = std::cos(beamWidth / 2.0f);
-
-            if (angleCos >= halfBeamWidthCos) {
-                b2Vec2 velocity = direction;
-
-                // Modify velocity based on power and scaling factor
-                float scalingFactor = calculateScalingFactor();
-                velocity *= waveSpeed * scalingFactor * (transmitPower / 100.0f);
-
-                particle->SetLinearVelocity(velocity);
-
-                qDebug() << "Particle velocity: " << velocity.x << ", " << velocity.y;
-            }
-        }
-
-        if (isHumanTouch(callback.nearbyBodies)) {
-            emit humanTouched(m_levelNumber);
-        }
-    }
-
-    qDebug() << "Wave emitted with beam width:" << beamWidth << "and speed:" << waveSpeed << "and power:" << transmitPower;
+    InputEvent command;
+    command.command = InputCommand::PropagationMode;
+    command.value = static_cast<int>(mode == "grid" ? PropagationMode::FdtdGrid : PropagationMode::ParticleMesh);
+    sendCommand(command);
 }
 
-bool Model::isHumanTouch(const std::vector<b2Body*> &queriedBodies)
+void Model::setContinuousWave(bool enabled)
 {
-
-    for (b2Body* body : queriedBodies)
-    {
-        if (std::find(levelObjects.begin(), levelObjects.end(), body) != levelObjects.end())
-        {
-            for (const ObjectData& obj : levelItems)
-            {
-                if (obj.type == ObjectType::Human &&
-                    (obj.objPos - body->GetPosition()).LengthSquared() < 1e-6f)
-                {
-                    return true; // Human is within the aabb
-                }
-            }
-        }
-    }
-    return false;
+    InputEvent command;
+    command.command = InputCommand::ContinuousWave;
+    command.value = enabled ? 1 : 0;
+    sendCommand(command);
 }
 
-float Model::calculateScalingFactor() {
-    int p_min = 1;
-    int p_max = 100;
-
-    float s_min = 100000.0f;
-    float s_max = 1000000000.0f; // max scaling factor
-
-    float n = 1.00001;
-    float alpha = 1000.0f;
-
-    if (transmitPower < p_min) transmitPower = p_min;
-    if (transmitPower > p_max) transmitPower = p_max;
-
-    // exponential mapping (power to scaling factor)
-    //float scalingFactor = s_min + (s_max - s_min) * pow((transmitPower - p_min) / (float)(p_max - p_min), n);
-    //float scalingFactor = (s_max - s_min) * pow((transmitPower - p_min) / (float)(p_max - p_min), n);
-
-    // logarithmic mapping
-    //float scalingFactor = s_min + (s_max - s_min) * (log(transmitPower + 1) / log(p_max + 1)) / alpha;
-    //float scalingFactor = s_min + (s_max - s_min) * (log((transmitPower + alpha) / alpha) / log((p_max + alpha) / alpha));
-
-    // linear mapping
-    float scalingFactor = (s_min / 100) + (s_max - s_min) * ((transmitPower - p_min) / (float)(p_max - p_min));
+void Model::setCoverageVisible(bool visible)
+{
+    coverageVisible = visible;
+    shownCoverage.reset();  // Send the current map even if it did not change
+}
 
-    return scalingFactor;
+void Model::emitWave()
+{
+    InputEvent command;
+    command.command = InputCommand::EmitWave;
+    sendCommand(command);
 }
 
 void Model::onSetupNextLevel(int levelNumber)
 {
-    switch (levelNumber) {
-    case 1:
-        setUpLevel(LevelWorlds::createLevel1());
-        break;
-    case 2:
-        setUpLevel(LevelWorlds::createLevel2());
-        break;
-    case 3:
-        setUpLevel(LevelWorlds::createLevel3());
-        break;
-    case 4:
-        setUpLevel(LevelWorlds::createLevel4());
-        break;
-    case 5:
-        setUpLevel(LevelWorlds::createLevel5());
-        break;
-    default:
+    if (levelNumber < 1 || levelNumber > 5) {
         qDebug() << "Invalid level number: " << levelNumber;
         return;
     }
-
-    // Update the environment after setting up the level
-    step(); // Start the simulation for the new level
-}
-
-Model::LevelWorlds::LevelWorlds(const QVector<ObjectData> &obj)
-    : obj(obj) {}
-
-QString Model::LevelWorlds::getBackgroundPath() const {
-    return backgroundPath;
-}
-
-QVector<ObjectData> Model::LevelWorlds::getObjects() const {
-    return obj;
-}
-
-// Level World
-Model::LevelWorlds Model::LevelWorlds::createLevel1() {
-    QVector<ObjectData> objects= {
-         {{b2Vec2(150.0f, 700.0f)},  ObjectType::Human},
-         {{b2Vec2(420.0f, 300.0f)},  ObjectType::Human}
-    };
-    return LevelWorlds(objects);
-}
-
-Model::LevelWorlds Model::LevelWorlds::createLevel2() {
-    QVector<ObjectData> objects= {
-        {{b2Vec2(150.0f, 700.0f)},  ObjectType::Human},
-        {{b2Vec2(1000.0f, 700.0f)},  ObjectType::Human}
-    };
-    return LevelWorlds(objects);
-}
-
-
-Model::LevelWorlds Model::LevelWorlds::createLevel3() {
-    QVector<ObjectData> objects = {
-        {{b2Vec2(740.0f,300.0f)} , ObjectType::Hill},
-        {{b2Vec2(150.0f, 700.0f)},  ObjectType::Human},
-        {{b2Vec2(630.0f, 350.0f)},  ObjectType::Human}
-        //{{b2Vec2(320.0f, 750.0f)},  ObjectType::Human}
-    };
-    return LevelWorlds(objects);
-}
-
-Model::LevelWorlds Model::LevelWorlds::createLevel4() {
-    QVector<ObjectData> objects= {
-        {{b2Vec2(800.0f,300.0f)} , ObjectType::Hill},
-        {{b2Vec2(150.0f, 700.0f)},  ObjectType::Human},
-        {{b2Vec2(1000.0f, 700.0f)},  ObjectType::Human}
-    };
-    return LevelWorlds(objects);
-}
-
-Model::LevelWorlds Model::LevelWorlds::createLevel5() {
-    QVector<ObjectData> objects= {
-        {{b2Vec2(150.0f, 700.0f)},  ObjectType::Human},
-        {{b2Vec2(1000.0f, 700.0f)},  ObjectType::Human},
-        //{{b2Vec2(320.0f, 700.0f)},  ObjectType::Human},
-        {{b2Vec2(500.0f, 750.0f)}, ObjectType::Rock},
-        {{b2Vec2(550.0f, 570.0f)}, ObjectType::Tree}
-    };
-    return LevelWorlds(objects);
+    resetLevel(levelNumber);
 }
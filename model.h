@@ -1,9 +1,11 @@
 /**
  * @file Model.h
  * @brief This class is the model component of the MVC architecture for the app.
- * It manages the game elements, simulating their dynamics and interactions according to
- * user inputs and game rules. This includes creating elements like avatars, ground,
- * sky, obstacles, and a particle mesh for wave propagation visualization.
+ * It is a thin Qt adapter around the headless WaveSimulation engine, which it
+ * runs on a thread of its own: user inputs are pushed to that thread through a
+ * lock-free command queue, and the results come back through snapshot buffers
+ * that the GUI thread reads without blocking and publishes to the view through
+ * Qt signals. A slow physics step therefore never stalls painting or input.
  *
  * @author: Trentton Stratton, Phuc Hoang, Chanphone Visathip, Thu Ha.
  * @date: 12/12/2024
@@ -15,27 +17,27 @@
 #include <QObject>
 #include <QVector>
 #include <QDebug>
-#include "math.h"
-#include "Box2D/Box2D.h"
-
-// Enumeration for different types of game objects.
-enum ObjectType
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include "commandqueue.h"
+#include "inputlog.h"
+#include "snapshotbuffer.h"
+#include "wavesimulation.h"
+
+// State of the simulation thread published with every frame.
+struct ModelStatus
 {
-    Rock,
-    Tree,
-    Hill,
-    Human
+    std::shared_ptr<const std::vector<ObjectData>> levelItems;  // Objects of the current level, shared until it changes
+    int levelNumber = 0;
+    unsigned touchCount = 0;  // Times a probe triggered so far
+    float alpha = 0.0f;  // Interpolation alpha when the status was published
+    std::chrono::steady_clock::time_point time;  // When the status was published
+    std::shared_ptr<const CoverageMap> coverage;  // Latest coverage map, if it is shown
 };
 
-// Structure to store object data including position and type.
-struct ObjectData
-{
-    b2Vec2 objPos;
-    ObjectType type;
-    ObjectData(b2Vec2 position, ObjectType objType) : objPos(position), type(objType) {}
-};
-
-// The Model class manages the game's physical simulation and state.
+// The Model class exposes the game's physical simulation to the Qt view.
 class Model : public QObject
 {
     Q_OBJECT
@@ -44,97 +46,92 @@ public:
     explicit Model(int levelNumber);
     ~Model();
 
-    // Simulation properties
-    float deltaTime;
-    int windowWidth;
-    int windowHeight;
-
-    // Radio transmission settings
-    b2Vec2 transmitLocation;
-    b2Vec2 transmitDirection;
-    b2Vec2 playerLocation;
-    int antennaHeight;
-    int transmitPower;
-    float beamWidth = 360.0f;  // Default to omnidirectional
-    float waveSpeed = 1.0f;    // Default wave speed
-    QString frequencyBand;
-
-    // Methods for particle mesh and game object management
-    void addParticleMesh(int particleSpacing, int particleSize, int windowWidth, int windowHeight);
-    void createParticleMeshJoint(b2Body* bodyA, b2Body* bodyB, int particleSpacing);
-    b2Body* addParticle(b2Vec2 position, int particleSize);
-    b2Body* addGround(b2Vec2 position);
-    b2Body* addSky(b2Vec2 position);
-    b2Body* addRock(b2Vec2 position);
-    b2Body* addTree(b2Vec2 position);
-    b2Body* addHill(b2Vec2 position);
-    b2Body* addHuman(b2Vec2 position);
-    void getPosition();
+    using LevelWorlds = ::LevelWorlds;
+
+    void getPosition(float alpha = 1.0f);
+    // Asks the simulation thread for one more step.
     void step();
-    void deleteAddedObjects();
-    QVector<int> calculateClosestParticles();
-    float calculateScalingFactor();
+    // Sends the latest results of the simulation thread to the view. Called
+    // once per displayed frame; it never waits for the simulation.
+    void advance(float elapsedSeconds);
+    // Starts or pauses the simulation clock, starting the thread on first use.
+    void setRunning(bool running);
+    // Indices in the particle frame of the count mesh particles closest to a point.
+    QVector<int> calculateClosestParticles(b2Vec2 point, int count = 1);
+    // Layout of the particle mesh, fixed for the life of the model.
+    const LatticeIndex& getLatticeIndex() const;
     void emitWave();
     void getObjectPosition();
+    void getCoverage();
 
     // Radio settings adjustments
     void setAntennaHeight(int height);
-    void setAntennaLocation(int antennaHeight);
     void setTransmitPower(int powerLevel);
     void setFrequencyBand(QString frequency);
     void setAntennaType(QString antenna);
     void setAntennaOrientation(int angleDegrees);
-    bool isHumanTouch(const std::vector<b2Body*>& queriedBodies);
-
-    // Nested class for managing level-specific worlds.
-    class LevelWorlds
-    {
-    public:
-        LevelWorlds(const QVector<ObjectData> &obj);
-        QString getBackgroundPath() const;
-        QVector<ObjectData> getObjects() const;
-
-        // Static methods to create specific level configurations.
-        static LevelWorlds createLevel1();
-        static LevelWorlds createLevel2();
-        static LevelWorlds createLevel3();
-        static LevelWorlds createLevel4();
-        static LevelWorlds createLevel5();
-
-    private:
-        QString backgroundPath;
-        QVector<ObjectData> obj;
-    };
-
-    // Callback class for querying nearby particle bodies.
-    class ParticleQueryCallback : public b2QueryCallback
-    {
-    public:
-        std::vector<b2Body*> nearbyBodies;
-
-        bool ReportFixture(b2Fixture* fixture) override
-        {
-            b2Body* body = fixture->GetBody();
-            nearbyBodies.push_back(body);
-            return true;  // Keep going to the next fixture.
-        }
-    };
-
-    // Setup method for initializing levels.
-    void setUpLevel(Model::LevelWorlds level);
+    void setPropagationMode(QString mode);
+    void setContinuousWave(bool enabled);
+    void setCoverageVisible(bool visible);
+
+    // Replaces the current level in place, reusing the simulation.
+    void resetLevel(int levelNumber);
+    // Builds a level on the simulation thread ahead of time, while the model
+    // is paused, so that resetLevel() for it is instant. Any other command
+    // sent in between cancels the preload.
+    void preloadLevel(int levelNumber);
+
+    // Records every command from now on to a log that InputLog can replay.
+    // The log is finished when the model is destroyed. Both recordings must
+    // start before the model first runs.
+    bool startRecording(const QString& path);
+    // Streams the wave state after every step to a trajectory file.
+    bool startTrajectory(const QString& path);
 
 private:
-    b2World* world;  // The Box2D world for the simulation
-    QVector<b2Body*> levelObjects;  // Bodies representing game objects
-    QVector<b2Body*> particleMesh;  // Bodies representing the particle mesh
-    QVector<ObjectData> levelItems;  // Data about the objects in the current level
-    int m_levelNumber;  // The current level number
+    void sendCommand(const InputEvent& command);
+    void flushCommands();
+    // Simulation thread
+    void run();
+    void applyCommands();
+    void applyCommand(const InputEvent& command);
+    void publishStatus();
+
+    WaveSimulation simulation;  // The headless simulation engine, owned by the simulation thread
+    int initialLevel;  // Level the simulation was created with
+    InputRecorder recorder;  // Command log, when recording
+
+    std::thread worker;  // The simulation thread
+    std::atomic<bool> running{false};  // Whether simulated time advances
+    std::atomic<bool> quit{false};
+    std::atomic<int> stepRequests{0};  // Single steps asked for by step()
+    std::atomic<bool> coverageVisible{false};  // Whether the view shows the coverage heatmap
+
+    CommandQueue<InputEvent, 256> commands;  // Controls on their way to the simulation thread
+    std::vector<InputEvent> overflow;  // Commands that found the queue full, oldest first
+    std::vector<InputEvent> pending;  // Commands popped by the simulation thread
+    SnapshotBuffer<ModelStatus> statusBuffer;  // Status handed to the GUI thread
+
+    // Simulation thread state
+    unsigned touchCount = 0;
+    bool layoutChanged = true;  // Whether a level reset was applied since the last status
+    std::shared_ptr<const std::vector<ObjectData>> levelItems;
+    unsigned publishedCoverage = 0;  // Revision of the coverage map last published
+    std::shared_ptr<const CoverageMap> coverage;
+
+    // GUI thread state
+    const ModelStatus* status = nullptr;  // Status last read
+    unsigned seenTouchCount = 0;
+    int preloadedLevel = 0;  // Level built by preloadLevel(), or 0
+    std::shared_ptr<const std::vector<ObjectData>> shownLevelItems;  // Objects last sent to the view
+    std::shared_ptr<const CoverageMap> shownCoverage;  // Coverage map last sent to the view
 
 signals:
     void stateChanged();  // Signal to indicate that the model state has changed
-    void updateParticlePositions(QVector<b2Vec2> positions);
-    void updateObjectsPositions(QVector<ObjectData> positions);
-    void humanTouched(int);
+    void updateParticlePositions(const ParticleFrame& frame, float alpha);  // Valid until the next emission
+    void updateObjectsPositions(QVector<ObjectData> positions);  // Emitted only when the level changed
+    void updateCoverage(const CoverageMap& coverage);  // Emitted only when the map changed
+    void humanTouched(int);  // Emitted by advance() when the wave reaches a human target
 
 public slots:
     void onSetupNextLevel(int levelNumber);  // Slot to handle setting up the next level
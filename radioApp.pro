@@ -54,14 +54,25 @@ SOURCES += \
     Box2D/Dynamics/b2Island.cpp \
     Box2D/Dynamics/b2World.cpp \
     Box2D/Dynamics/b2WorldCallbacks.cpp \
+    Box2D/Particle/b2ParticleSystem.cpp \
     Box2D/Rope/b2Rope.cpp \
     GUI.cpp \
+    amplituderenderer.cpp \
+    coveragemap.cpp \
     environment.cpp \
+    fdtdsolver.cpp \
     gamemenupage.cpp \
+    inputlog.cpp \
+    latticeindex.cpp \
     levelcompletepage.cpp \
     levelinstructionpage.cpp \
+    levelsolver.cpp \
+    linearresponse.cpp \
     main.cpp \
-    model.cpp
+    model.cpp \
+    spriteatlas.cpp \
+    trajectoryfile.cpp \
+    wavesimulation.cpp
 
 HEADERS += \
     Box2D/Box2D.h \
@@ -110,13 +121,26 @@ HEADERS += \
     Box2D/Dynamics/b2TimeStep.h \
     Box2D/Dynamics/b2World.h \
     Box2D/Dynamics/b2WorldCallbacks.h \
+    Box2D/Particle/b2ParticleSystem.h \
     Box2D/Rope/b2Rope.h \
     GUI.h \
+    amplituderenderer.h \
+    commandqueue.h \
+    coveragemap.h \
     environment.h \
+    fdtdsolver.h \
     gamemenupage.h \
+    inputlog.h \
+    latticeindex.h \
     levelcompletepage.h \
     levelinstructionpage.h \
-    model.h
+    levelsolver.h \
+    linearresponse.h \
+    model.h \
+    snapshotbuffer.h \
+    spriteatlas.h \
+    trajectoryfile.h \
+    wavesimulation.h
 
 FORMS += \
     GUI.ui
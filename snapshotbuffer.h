@@ -0,0 +1,65 @@
+/**
+ * @file SnapshotBuffer.h
+ * @brief This class hands the latest simulation results from the producer to the
+ * view without copying or allocating. It keeps three preallocated slots: the
+ * producer fills one, the reader holds another, and the third holds the latest
+ * published snapshot. Publishing and reading only swap slot indices, so one
+ * producer thread and one reader thread never block each other.
+ *
+ * @author: Trentton Stratton, Phuc Hoang, Chanphone Visathip, Thu Ha.
+ * @date: 12/12/2024
+ */
+
+#ifndef SNAPSHOTBUFFER_H
+#define SNAPSHOTBUFFER_H
+
+#include <atomic>
+
+// The SnapshotBuffer class is a single-producer, single-reader triple buffer.
+template <typename T>
+class SnapshotBuffer
+{
+public:
+    SnapshotBuffer() = default;
+
+    SnapshotBuffer(const SnapshotBuffer&) = delete;
+    SnapshotBuffer& operator=(const SnapshotBuffer&) = delete;
+
+    // The slot the producer fills next. It keeps the contents it had when it
+    // was last handed back, so containers inside it keep their capacity.
+    T& writeSlot() { return snapshots[writeIndex]; }
+
+    // Publishes the write slot as the latest snapshot and takes back the stale
+    // slot for the next write.
+    void publish()
+    {
+        writeIndex = latest.exchange(writeIndex | freshFlag, std::memory_order_acq_rel) & indexMask;
+    }
+
+    // Returns the latest published snapshot. The reference stays valid and
+    // unchanged until the next call to read().
+    const T& read()
+    {
+        if (latest.load(std::memory_order_acquire) & freshFlag) {
+            readIndex = latest.exchange(readIndex, std::memory_order_acq_rel) & indexMask;
+        }
+        return snapshots[readIndex];
+    }
+
+    // True if a snapshot was published since the last call to read().
+    bool hasNewSnapshot() const
+    {
+        return latest.load(std::memory_order_acquire) & freshFlag;
+    }
+
+private:
+    static const int indexMask = 3;
+    static const int freshFlag = 4;
+
+    T snapshots[3];  // Not "slots", which Qt defines as a macro
+    int writeIndex = 0;  // Owned by the producer
+    int readIndex = 1;  // Owned by the reader
+    std::atomic<int> latest{2};  // Latest published slot, plus the fresh flag
+};
+
+#endif // SNAPSHOTBUFFER_H
@@ -0,0 +1,62 @@
+/**
+ * This class is the sprite atlas for the view (GUI.cpp).
+ *
+ * It scales the object images to their drawn size
+ * and packs them into one pixmap at start-up.
+ */
+
+#include "spriteatlas.h"
+
+#include <QImage>
+#include <QPainter>
+#include <algorithm>
+
+namespace
+{
+// Resource and scale of the sprite of each object type, by ObjectType value.
+struct SpriteSource
+{
+    const char* path;
+    float scale;
+};
+
+const SpriteSource spriteSources[] = {
+    {":/img/rock.png", 0.1f},
+    {":/img/tree.png", 0.15f},
+    {":/img/hills.png", 0.4f},
+    {":/img/human.png", 0.15f},
+};
+
+// Transparent gap between sprites, so smooth scaling of a drawn sprite never
+// samples its neighbour.
+const int spritePadding = 2;
+}
+
+SpriteAtlas::SpriteAtlas()
+{
+    static_assert(sizeof(spriteSources) / sizeof(spriteSources[0]) == spriteCount, "One source per object type");
+
+    QImage images[spriteCount];
+    int width = 0;
+    int height = 0;
+    for (int i = 0; i < spriteCount; ++i) {
+        QImage image(spriteSources[i].path);
+        images[i] = image.scaled(image.width() * spriteSources[i].scale,
+                                 image.height() * spriteSources[i].scale,
+                                 Qt::KeepAspectRatio,
+                                 Qt::SmoothTransformation);
+        m_sprites[i] = QRect(width, 0, images[i].width(), images[i].height());
+        width += images[i].width() + spritePadding;
+        height = std::max(height, images[i].height());
+    }
+
+    QImage atlas(std::max(1, width), std::max(1, height), QImage::Format_ARGB32_Premultiplied);
+    atlas.fill(Qt::transparent);
+    QPainter painter(&atlas);
+    for (int i = 0; i < spriteCount; ++i) {
+        painter.drawImage(m_sprites[i].topLeft(), images[i]);
+    }
+    painter.end();
+
+    m_pixmap = QPixmap::fromImage(atlas);
+}
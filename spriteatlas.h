@@ -0,0 +1,38 @@
+/**
+ * @file SpriteAtlas.h
+ * @brief This class holds the images of the level objects, decoded and scaled to
+ * their on-screen size once, when the window is created, and packed side by side
+ * into a single pixmap. Drawing an object is then a copy of a rectangle of that
+ * pixmap: no resource is read and no image is rescaled while a level is played.
+ *
+ * @author: Trentton Stratton, Phuc Hoang, Chanphone Visathip, Thu Ha.
+ * @date: 12/12/2024
+ */
+
+#ifndef SPRITEATLAS_H
+#define SPRITEATLAS_H
+
+#include <QPixmap>
+#include <QRect>
+#include "wavesimulation.h"
+
+// The SpriteAtlas class maps every object type to its sprite in one pixmap.
+class SpriteAtlas
+{
+public:
+    // Loads and packs the sprites. Needs a QGuiApplication.
+    SpriteAtlas();
+
+    // The packed sprites.
+    const QPixmap& pixmap() const { return m_pixmap; }
+    // Area of the pixmap holding the sprite of an object type.
+    QRect sprite(ObjectType type) const { return m_sprites[type]; }
+
+private:
+    static const int spriteCount = Human + 1;
+
+    QPixmap m_pixmap;
+    QRect m_sprites[spriteCount];
+};
+
+#endif // SPRITEATLAS_H
@@ -0,0 +1,373 @@
+/**
+ * This class is the trajectory recorder and reader.
+ *
+ * It quantises the displacement of every mesh node
+ * into fixed-size frames of a memory-mapped file,
+ * and maps them back for analysis.
+ */
+
+#include "trajectoryfile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+const char fileTag[4] = {'R', 'T', 'R', 'J'};
+const uint32_t fileVersion = 1;
+const size_t headerSize = 64;
+const size_t minGrowth = size_t(64) << 20;  // Bytes mapped at a time while recording
+
+struct FileHeader
+{
+    char tag[4];
+    uint32_t version;
+    uint32_t columns;
+    uint32_t rows;
+    float originX;
+    float originY;
+    float spacing;
+    float deltaTime;
+    uint32_t frameStride;
+    uint32_t reserved;
+    uint64_t frameCount;
+    uint64_t indexOffset;  // 0 until the recording is finished
+};
+static_assert(sizeof(FileHeader) <= headerSize, "The file header must fit its slot");
+
+// Start of every frame, followed by two int16 per node.
+struct FrameHeader
+{
+    uint64_t step;
+    float scale;  // Pixels per quantisation unit
+    uint32_t reserved;
+};
+
+size_t frameStrideFor(size_t nodeCount)
+{
+    size_t bytes = sizeof(FrameHeader) + nodeCount * 2 * sizeof(int16_t);
+    return (bytes + 15) & ~size_t(15);
+}
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::create(const std::string& path, size_t size)
+{
+    close();
+#ifdef _WIN32
+    m_file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                         CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) {
+        m_file = nullptr;
+        return false;
+    }
+#else
+    m_file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_file < 0) {
+        return false;
+    }
+#endif
+    m_size = size;
+    if (!map(true)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::openReadOnly(const std::string& path)
+{
+    close();
+#ifdef _WIN32
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER size;
+    if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &size)) {
+        m_file = nullptr;
+        return false;
+    }
+    m_size = size_t(size.QuadPart);
+#else
+    m_file = ::open(path.c_str(), O_RDONLY);
+    struct stat status;
+    if (m_file < 0 || fstat(m_file, &status) != 0) {
+        close();
+        return false;
+    }
+    m_size = size_t(status.st_size);
+#endif
+    if (m_size == 0 || !map(false)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::map(bool writable)
+{
+    m_writable = writable;
+#ifdef _WIN32
+    DWORD protection = writable ? PAGE_READWRITE : PAGE_READONLY;
+    unsigned long long size = writable ? m_size : 0;
+    m_mapping = CreateFileMappingA(m_file, nullptr, protection, DWORD(size >> 32), DWORD(size & 0xffffffffu), nullptr);
+    if (!m_mapping) {
+        return false;
+    }
+    m_data = static_cast<unsigned char*>(MapViewOfFile(m_mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, m_size));
+    return m_data != nullptr;
+#else
+    if (writable && ftruncate(m_file, off_t(m_size)) != 0) {
+        return false;
+    }
+    void* data = mmap(nullptr, m_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, m_file, 0);
+    m_data = data == MAP_FAILED ? nullptr : static_cast<unsigned char*>(data);
+    return m_data != nullptr;
+#endif
+}
+
+void MappedFile::unmap()
+{
+#ifdef _WIN32
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+#else
+    if (m_data) {
+        munmap(m_data, m_size);
+    }
+#endif
+    m_data = nullptr;
+}
+
+bool MappedFile::resize(size_t size)
+{
+    if (!m_writable || !m_data) {
+        return false;
+    }
+    unmap();
+    m_size = size;
+    return map(true);
+}
+
+void MappedFile::close(size_t size)
+{
+    unmap();
+#ifdef _WIN32
+    if (m_file) {
+        if (m_writable) {
+            LARGE_INTEGER end;
+            end.QuadPart = LONGLONG(size);
+            SetFilePointerEx(m_file, end, nullptr, FILE_BEGIN);
+            SetEndOfFile(m_file);
+        }
+        CloseHandle(m_file);
+        m_file = nullptr;
+    }
+#else
+    if (m_file >= 0) {
+        if (m_writable) {
+            // On failure the file keeps its mapped size; the header still has the frame count.
+            int result = ftruncate(m_file, off_t(size));
+            (void)result;
+        }
+        ::close(m_file);
+        m_file = -1;
+    }
+#endif
+    m_size = 0;
+    m_writable = false;
+}
+
+void MappedFile::close()
+{
+    close(m_size);
+}
+
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+    close();
+}
+
+bool TrajectoryRecorder::open(const std::string& path, const TrajectoryLattice& lattice)
+{
+    close();
+    m_nodeCount = size_t(lattice.columns) * size_t(lattice.rows);
+    m_frameStride = frameStrideFor(m_nodeCount);
+    m_frameCount = 0;
+    m_steps.clear();
+
+    if (!m_file.create(path, std::max(minGrowth, headerSize + m_frameStride))) {
+        return false;
+    }
+
+    FileHeader header = {};
+    std::memcpy(header.tag, fileTag, sizeof(fileTag));
+    header.version = fileVersion;
+    header.columns = uint32_t(lattice.columns);
+    header.rows = uint32_t(lattice.rows);
+    header.originX = lattice.origin.x;
+    header.originY = lattice.origin.y;
+    header.spacing = lattice.spacing;
+    header.deltaTime = lattice.deltaTime;
+    header.frameStride = uint32_t(m_frameStride);
+    std::memcpy(m_file.data(), &header, sizeof(header));
+    return true;
+}
+
+void TrajectoryRecorder::append(uint64_t step, const b2Vec2* positions, const b2Vec2* restPositions)
+{
+    if (!isOpen()) {
+        return;
+    }
+
+    size_t end = headerSize + size_t(m_frameCount + 1) * m_frameStride;
+    if (end > m_file.size() && !m_file.resize(std::max(end, m_file.size() + std::max(minGrowth, m_file.size() / 2)))) {
+        close();
+        return;
+    }
+
+    // One scale per frame, set by its largest displacement, so quiet frames
+    // keep their resolution.
+    float largest = 0.0f;
+    for (size_t i = 0; i < m_nodeCount; ++i) {
+        b2Vec2 displacement = positions[i] - restPositions[i];
+        largest = std::max(largest, std::max(std::fabs(displacement.x), std::fabs(displacement.y)));
+    }
+    float scale = largest / 32767.0f;
+    float inverse = largest > 0.0f ? 1.0f / scale : 0.0f;
+
+    unsigned char* frame = m_file.data() + headerSize + size_t(m_frameCount) * m_frameStride;
+    FrameHeader frameHeader = {step, scale, 0};
+    std::memcpy(frame, &frameHeader, sizeof(frameHeader));
+
+    int16_t* values = reinterpret_cast<int16_t*>(frame + sizeof(FrameHeader));
+    for (size_t i = 0; i < m_nodeCount; ++i) {
+        b2Vec2 displacement = inverse * (positions[i] - restPositions[i]);
+        values[2 * i] = int16_t(std::lround(displacement.x));
+        values[2 * i + 1] = int16_t(std::lround(displacement.y));
+    }
+
+    ++m_frameCount;
+    m_steps.push_back(step);
+    std::memcpy(m_file.data() + offsetof(FileHeader, frameCount), &m_frameCount, sizeof(m_frameCount));
+}
+
+void TrajectoryRecorder::close()
+{
+    if (!isOpen()) {
+        return;
+    }
+
+    uint64_t indexOffset = headerSize + m_frameCount * m_frameStride;
+    size_t end = size_t(indexOffset) + m_steps.size() * sizeof(uint64_t);
+    if (end <= m_file.size() || m_file.resize(end)) {
+        std::memcpy(m_file.data() + indexOffset, m_steps.data(), m_steps.size() * sizeof(uint64_t));
+        std::memcpy(m_file.data() + offsetof(FileHeader, indexOffset), &indexOffset, sizeof(indexOffset));
+    } else {
+        end = size_t(indexOffset);
+    }
+    m_file.close(end);
+    m_steps.clear();
+}
+
+bool TrajectoryReader::open(const std::string& path)
+{
+    m_index = nullptr;
+    m_frameCount = 0;
+    if (!m_file.openReadOnly(path) || m_file.size() < headerSize) {
+        m_file.close();
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, m_file.data(), sizeof(header));
+    if (std::memcmp(header.tag, fileTag, sizeof(fileTag)) != 0 || header.version != fileVersion ||
+        header.frameStride != frameStrideFor(size_t(header.columns) * header.rows)) {
+        m_file.close();
+        return false;
+    }
+
+    m_lattice.origin = b2Vec2(header.originX, header.originY);
+    m_lattice.spacing = header.spacing;
+    m_lattice.columns = int(header.columns);
+    m_lattice.rows = int(header.rows);
+    m_lattice.deltaTime = header.deltaTime;
+    m_frameStride = header.frameStride;
+
+    // Only whole frames count, in case the recording was cut short.
+    m_frameCount = std::min<uint64_t>(header.frameCount, (m_file.size() - headerSize) / m_frameStride);
+    if (header.indexOffset != 0 && header.indexOffset + m_frameCount * sizeof(uint64_t) <= m_file.size()) {
+        m_index = reinterpret_cast<const uint64_t*>(m_file.data() + header.indexOffset);
+    }
+    return true;
+}
+
+uint64_t TrajectoryReader::frameStep(uint64_t frame) const
+{
+    if (m_index) {
+        return m_index[frame];
+    }
+    uint64_t step;
+    std::memcpy(&step, m_file.data() + headerSize + size_t(frame) * m_frameStride, sizeof(step));
+    return step;
+}
+
+int64_t TrajectoryReader::findFrame(uint64_t step) const
+{
+    if (m_frameCount == 0) {
+        return -1;
+    }
+
+    // Recordings normally hold every step, which puts the step at a known frame.
+    uint64_t first = frameStep(0);
+    if (step < first) {
+        return -1;
+    }
+    uint64_t guess = step - first;
+    if (guess < m_frameCount && frameStep(guess) == step) {
+        return int64_t(guess);
+    }
+
+    uint64_t low = 0;
+    uint64_t high = m_frameCount;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        if (frameStep(middle) < step) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < m_frameCount && frameStep(low) == step ? int64_t(low) : -1;
+}
+
+void TrajectoryReader::readFrame(uint64_t frame, std::vector<b2Vec2>& displacements) const
+{
+    const unsigned char* data = m_file.data() + headerSize + size_t(frame) * m_frameStride;
+    FrameHeader frameHeader;
+    std::memcpy(&frameHeader, data, sizeof(frameHeader));
+
+    const int16_t* values = reinterpret_cast<const int16_t*>(data + sizeof(FrameHeader));
+    displacements.resize(size_t(nodeCount()));
+    for (size_t i = 0; i < displacements.size(); ++i) {
+        displacements[i] = frameHeader.scale * b2Vec2(values[2 * i], values[2 * i + 1]);
+    }
+}
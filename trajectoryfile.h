@@ -0,0 +1,140 @@
+/**
+ * @file TrajectoryFile.h
+ * @brief These classes stream the state of the wave medium to disk and read it
+ * back. Every recorded step stores the displacement of each lattice node from
+ * its rest position, quantised to 16-bit integers with a per-frame scale, in a
+ * frame of fixed size. The file is memory-mapped and grown in large chunks, so
+ * appending a frame is a quantising copy with no system call, and frame i sits
+ * at a fixed offset that the reader maps to directly.
+ *
+ * Layout: a 64-byte header, the frames, then an index of the step of every
+ * frame written when the recording is finished. The header's frame count is
+ * kept current while recording, so a file cut short by a crash still reads up
+ * to its last frame.
+ *
+ * @author: Trentton Stratton, Phuc Hoang, Chanphone Visathip, Thu Ha.
+ * @date: 12/12/2024
+ */
+
+#ifndef TRAJECTORYFILE_H
+#define TRAJECTORYFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Box2D/Common/b2Math.h"
+
+// Lattice the recorded nodes belong to, nodes numbered row by row.
+struct TrajectoryLattice
+{
+    b2Vec2 origin = b2Vec2(0.0f, 0.0f);  // Rest position of node 0
+    float spacing = 1.0f;  // Distance between neighbouring nodes
+    int columns = 0;
+    int rows = 0;
+    float deltaTime = 0.0f;  // Length of one simulation step
+};
+
+// A file mapped into memory, read-only or growable.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Creates or truncates a file and maps its first size bytes for writing.
+    bool create(const std::string& path, size_t size);
+    // Maps an existing file for reading.
+    bool openReadOnly(const std::string& path);
+    // Grows a writable mapping; the data may move.
+    bool resize(size_t size);
+    // Unmaps, cutting a writable file to size bytes first.
+    void close(size_t size);
+    void close();
+
+    unsigned char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    bool map(bool writable);
+    void unmap();
+
+    unsigned char* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_writable = false;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+};
+
+// The TrajectoryRecorder class appends frames to a trajectory file.
+class TrajectoryRecorder
+{
+public:
+    ~TrajectoryRecorder();
+
+    /**
+     * Starts a trajectory, replacing any file at the path.
+     * @param path The file to write.
+     * @param lattice The lattice of the recorded nodes.
+     * @return Whether the file could be created and mapped.
+     */
+    bool open(const std::string& path, const TrajectoryLattice& lattice);
+    bool isOpen() const { return m_file.data() != nullptr; }
+
+    /**
+     * Appends the state after a step. Steps must increase from frame to frame.
+     * @param step The number of steps taken.
+     * @param positions The current position of every node.
+     * @param restPositions The rest position of every node.
+     */
+    void append(uint64_t step, const b2Vec2* positions, const b2Vec2* restPositions);
+
+    // Writes the index and closes the file.
+    void close();
+
+    uint64_t frameCount() const { return m_frameCount; }
+
+private:
+    MappedFile m_file;
+    size_t m_nodeCount = 0;
+    size_t m_frameStride = 0;
+    uint64_t m_frameCount = 0;
+    std::vector<uint64_t> m_steps;  // Step of every frame, for the index
+};
+
+// The TrajectoryReader class gives random access to the frames of a trajectory file.
+class TrajectoryReader
+{
+public:
+    // Maps a trajectory file. Returns false if it is missing or not a trajectory.
+    bool open(const std::string& path);
+
+    const TrajectoryLattice& lattice() const { return m_lattice; }
+    int nodeCount() const { return m_lattice.columns * m_lattice.rows; }
+    uint64_t frameCount() const { return m_frameCount; }
+
+    // Step recorded in a frame.
+    uint64_t frameStep(uint64_t frame) const;
+    // Frame holding a step, or -1 if the step was not recorded. Constant time
+    // when every step was recorded, logarithmic otherwise.
+    int64_t findFrame(uint64_t step) const;
+
+    // Decodes the node displacements of a frame.
+    void readFrame(uint64_t frame, std::vector<b2Vec2>& displacements) const;
+
+private:
+    MappedFile m_file;
+    TrajectoryLattice m_lattice;
+    size_t m_frameStride = 0;
+    uint64_t m_frameCount = 0;
+    const uint64_t* m_index = nullptr;  // Steps of the frames, if the file was finished
+};
+
+#endif // TRAJECTORYFILE_H
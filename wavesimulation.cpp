@@ -0,0 +1,1047 @@
+/**
+ * This class is the simulation engine behind the model.
+ *
+ * It is responsible for creating the elements of the
+ * game and determining their position at each step in
+ * time. The antenna settings it holds alter how the radio
+ * wave propagates through the medium.
+ *
+ * It deliberately has no Qt dependency: the model (model.cpp)
+ * wraps it and turns its results into signals for the view.
+ */
+
+#include "wavesimulation.h"
+
+#include <algorithm>
+#include <cmath>
+
+WaveSimulation::WaveSimulation(int levelNumber)
+{
+    windowWidth = 1200;
+    windowHeight = 800;
+
+    b2Vec2 gravity(0.0, 0.0);
+    world = new b2World(gravity);
+    deltaTime = 1.0f / 60.0f; // 60 FPS
+
+    coverageMap.reset(new CoverageMap(b2Vec2(0.0f, 0.0f), b2Vec2(windowWidth, windowHeight), 10.0f));
+
+    addGround(b2Vec2(0.0f, 850.0f));
+    addParticleMesh(20, 1, windowWidth, windowHeight); // 10, 1
+
+    m_levelNumber = levelNumber;
+    playerLocation.SetZero();
+    setUpLevel(LevelWorlds::createLevel(levelNumber));
+
+    playerLocation = b2Vec2(400.0f, 500.0f); // kind of arbitrary player position
+    transmitLocation = b2Vec2(playerLocation.x, playerLocation.y - 5 * 10);
+    setAntennaOrientation(0);
+}
+
+WaveSimulation::~WaveSimulation()
+{
+    delete world;
+}
+
+void WaveSimulation::setUpLevel(const LevelWorlds& level)
+{
+    bool firstHuman = true;  // The first human of a level is the player
+    for (const ObjectData& obj : level.getObjects())
+    {
+        switch (obj.type)
+        {
+        case ObjectType::Rock:
+            addRock(obj.objPos);
+            break;
+        case ObjectType::Tree:
+            addTree(obj.objPos);
+            break;
+        case ObjectType::Hill:
+            addHill(obj.objPos);
+            break;
+        case ObjectType::Human:
+            addHuman(obj.objPos);
+            if (!firstHuman) {
+                addProbe(obj.objPos);
+            }
+            firstHuman = false;
+            if (playerLocation.x == 0.0f) {  // Set playerLocation.x to the first human's position
+                playerLocation.x = obj.objPos.x;
+                playerLocation.y = obj.objPos.y;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    // levelObjects and levelItems are filled side by side.
+    std::vector<std::pair<const b2Body*, float>> losses;
+    for (size_t i = 0; i < levelObjects.size(); ++i)
+    {
+        losses.push_back(std::make_pair(levelObjects[i], getObstacleLoss(levelItems[i].type)));
+    }
+    coverageMap->setObstacles(world, losses);
+
+    rasterizeObstacles();
+    updatePreviewReceivers();
+}
+
+void WaveSimulation::rasterizeObstacles()
+{
+    nodeDamping = meshDamping;
+
+    for (size_t i = 0; i < levelObjects.size(); ++i)
+    {
+        // Targets are receivers, not obstacles.
+        ObjectType type = levelItems[i].type;
+        if (type == ObjectType::Human)
+        {
+            continue;
+        }
+
+        for (const b2Fixture* fixture = levelObjects[i]->GetFixtureList(); fixture; fixture = fixture->GetNext())
+        {
+            // Damping rate that takes the obstacle loss off the amplitude of a
+            // wave crossing the fixture: 20 log10(e) * rate / 2 * crossing time.
+            const b2AABB& box = fixture->GetAABB(0);
+            b2Vec2 size = box.upperBound - box.lowerBound;
+            float thickness = std::max(std::min(size.x, size.y), latticeIndex.spacing());
+            float rate = getObstacleLoss(type) * meshWaveSpeed / (4.343f * thickness);
+
+            LatticeIndex::Range cells = latticeIndex.range(box);
+            for (int row = cells.firstRow; row <= cells.lastRow; ++row)
+            {
+                for (int column = cells.firstColumn; column <= cells.lastColumn; ++column)
+                {
+                    int32 node = row * latticeIndex.columns() + column;
+                    if (fixture->TestPoint(restPositions[node]))
+                    {
+                        nodeDamping[node] = std::max(nodeDamping[node], rate);
+                    }
+                }
+            }
+        }
+    }
+
+    // A target standing on an obstacle still has to hear the wave.
+    for (const ReceiverProbe& probe : probes)
+    {
+        for (int32 node : probe.nodes)
+        {
+            nodeDamping[node] = meshDamping[node];
+        }
+    }
+
+    particleSystem->SetParticleDamping(particleMesh->GetBufferIndex(), int32(nodeDamping.size()), nodeDamping.data());
+}
+
+float WaveSimulation::getObstacleLoss(ObjectType type)
+{
+    switch (type)
+    {
+    case ObjectType::Rock:
+        return 15.0f;
+    case ObjectType::Tree:
+        return 6.0f;
+    case ObjectType::Hill:
+        return 25.0f;
+    case ObjectType::Human:
+        return 3.0f;
+    default:
+        return 0.0f;
+    }
+}
+
+const CoverageMap& WaveSimulation::getCoverage()
+{
+    CoverageMap::Settings settings;
+    settings.transmitLocation = transmitLocation;
+    settings.transmitDirection = transmitDirection;
+    settings.beamWidth = beamWidth;
+    settings.transmitPower = transmitPower;
+    settings.frequencyBand = frequencyBand;
+    coverageMap->update(settings);
+    return *coverageMap;
+}
+
+void WaveSimulation::readParticlePositions(std::vector<b2Vec2>& positions) const
+{
+    if (propagationMode == PropagationMode::FdtdGrid)
+    {
+        positions.resize(restPositions.size());
+        for (size_t i = 0; i < restPositions.size(); ++i)
+        {
+            positions[i] = restPositions[i] + fdtdSolver->displacement(restPositions[i]);
+        }
+    }
+    else
+    {
+        const b2Vec2* buffer = particleSystem->GetPositionBuffer() + particleMesh->GetBufferIndex();
+        positions.assign(buffer, buffer + particleMesh->GetParticleCount());
+    }
+}
+
+b2Vec2 WaveSimulation::getNodeDisplacement(int32 node) const
+{
+    if (propagationMode == PropagationMode::FdtdGrid)
+    {
+        return fdtdSolver->displacement(restPositions[node]);
+    }
+    return particleSystem->GetPositionBuffer()[particleMesh->GetBufferIndex() + node] - restPositions[node];
+}
+
+void WaveSimulation::publishParticleFrame(bool interpolate)
+{
+    // The write slot still holds a frame from two publishes ago, so its
+    // vectors already have the right size and nothing is allocated here.
+    // When interpolating, the previous positions were read before the last step.
+    ParticleFrame& frame = particleFrames.writeSlot();
+    frame.stepIndex = stepIndex;
+    readParticlePositions(frame.positions);
+    if (!interpolate)
+    {
+        frame.previousPositions = frame.positions;
+    }
+    particleFrames.publish();
+}
+
+void WaveSimulation::addProbe(b2Vec2 position)
+{
+    // Sample the lattice nodes within one spacing of the target.
+    ReceiverProbe probe;
+    probe.position = position;
+    latticeIndex.queryRadius(position, latticeIndex.spacing(), probe.nodes);
+    probes.push_back(probe);
+}
+
+void WaveSimulation::updateProbes()
+{
+    for (size_t i = 0; i < probes.size(); ++i)
+    {
+        ReceiverProbe& probe = probes[i];
+        float amplitudeSquared = 0.0f;
+        for (int32 node : probe.nodes)
+        {
+            amplitudeSquared = std::max(amplitudeSquared, getNodeDisplacement(node).LengthSquared());
+        }
+        probe.amplitude = std::sqrt(amplitudeSquared);
+
+        if (!probe.triggered && probe.amplitude >= probeThreshold)
+        {
+            probe.triggered = true;
+            triggeredProbes.push_back(int(i));
+        }
+    }
+}
+
+const std::vector<ReceiverProbe>& WaveSimulation::getProbes() const
+{
+    return probes;
+}
+
+const std::vector<int>& WaveSimulation::getTriggeredProbes() const
+{
+    return triggeredProbes;
+}
+
+void WaveSimulation::setProbeThreshold(float threshold)
+{
+    probeThreshold = threshold;
+}
+
+float WaveSimulation::getProbeThreshold() const
+{
+    return probeThreshold;
+}
+
+void WaveSimulation::resetProbes()
+{
+    for (ReceiverProbe& probe : probes)
+    {
+        probe.triggered = false;
+    }
+    triggeredProbes.clear();
+}
+
+void WaveSimulation::setPropagationMode(PropagationMode mode)
+{
+    if (mode == PropagationMode::FdtdGrid && !fdtdSolver)
+    {
+        // The grid covers the mesh and absorbs at its edges in the same way.
+        b2AABB bounds = getGridBounds();
+        fdtdSolver.reset(new FdtdSolver(bounds.lowerBound, bounds.upperBound, fdtdCellSize));
+        fdtdSolver->setAbsorbingLayer((absorbingCells + 1) * latticeIndex.spacing(), absorbingDamping);
+    }
+    propagationMode = mode;
+    publishParticleFrame(false);
+}
+
+PropagationMode WaveSimulation::getPropagationMode() const
+{
+    return propagationMode;
+}
+
+const ParticleFrame& WaveSimulation::getParticleFrame()
+{
+    return particleFrames.read();
+}
+
+const std::vector<b2Vec2>& WaveSimulation::getParticlePositions()
+{
+    return particleFrames.read().positions;
+}
+
+const std::vector<ObjectData>& WaveSimulation::getLevelItems() const
+{
+    return levelItems;
+}
+
+int WaveSimulation::getLevelNumber() const
+{
+    return m_levelNumber;
+}
+
+int32 WaveSimulation::findClosestParticle(b2Vec2 point) const
+{
+    return latticeIndex.nearest(point);
+}
+
+void WaveSimulation::findClosestParticles(b2Vec2 point, int count, std::vector<int32>& particles) const
+{
+    latticeIndex.queryNearest(point, count, particles);
+}
+
+void WaveSimulation::findParticlesInRadius(b2Vec2 center, float radius, std::vector<int32>& particles) const
+{
+    latticeIndex.queryRadius(center, radius, particles);
+}
+
+const LatticeIndex& WaveSimulation::getLatticeIndex() const
+{
+    return latticeIndex;
+}
+
+void WaveSimulation::addParticleMesh(int particleSpacing, int particleSize, int windowWidth, int windowHeight)
+{
+    b2ParticleSystemDef systemDef;
+    systemDef.radius = particleSize / 2.0f;
+    systemDef.density = 1.0f;
+    systemDef.gridCellSize = particleSpacing;
+    systemDef.tileSize = 8;
+    systemDef.linearSleepTolerance = 1.0f;  // Well under a pixel of motion per second
+    particleSystem = world->CreateParticleSystem(&systemDef);
+
+    // The whole lattice is one group covering the window plus one spacing,
+    // with the outermost particles pinned in place. Instead of reflecting off
+    // the pins, waves die out in an absorbing layer along the edges.
+    b2ParticleGroupDef meshDef;
+    meshDef.origin = b2Vec2(-particleSpacing, -particleSpacing);
+    meshDef.columnCount = windowWidth / particleSpacing + 3;
+    meshDef.rowCount = windowHeight / particleSpacing + 3;
+    meshDef.spacing = particleSpacing;
+    meshDef.borderFlags = b2_wallParticle;
+    meshDef.frequencyHz = 2.5f;       // stiffness 10
+    meshDef.dampingRatio = .1f;       // damping   5
+    meshDef.diagonalSprings = true;
+    meshDef.absorbingWidth = absorbingCells;
+    meshDef.absorbingDamping = absorbingDamping;
+    particleMesh = particleSystem->CreateParticleGroup(meshDef);
+
+    const b2Vec2* positions = particleSystem->GetPositionBuffer() + particleMesh->GetBufferIndex();
+    restPositions.assign(positions, positions + particleMesh->GetParticleCount());
+    latticeIndex = LatticeIndex(meshDef.origin, meshDef.spacing, meshDef.columnCount, meshDef.rowCount);
+    meshWaveSpeed = meshDef.spacing * 2.0f * b2_pi * meshDef.frequencyHz;
+
+    const float32* damping = particleSystem->GetDampingBuffer() + particleMesh->GetBufferIndex();
+    meshDamping.assign(damping, damping + particleMesh->GetParticleCount());
+
+    publishParticleFrame(false);
+}
+
+b2Body* WaveSimulation::addSky(b2Vec2 position)
+{
+    b2BodyDef skyDef;
+    skyDef.type = b2_staticBody;
+    skyDef.position.Set(position.x, position.y);
+
+    b2Body* skyBody = world->CreateBody(&skyDef);
+
+    b2PolygonShape skyBox;
+    skyBox.SetAsBox(1200.0f, 50.0f);
+
+    skyBody->CreateFixture(&skyBox, 0.0f);
+
+    return skyBody;
+}
+
+b2Body* WaveSimulation::addGround(b2Vec2 position)
+{
+    b2BodyDef groundDef;
+    groundDef.type = b2_staticBody;
+    groundDef.position.Set(position.x, position.y);
+
+    b2Body* groundBody = world->CreateBody(&groundDef);
+
+    b2PolygonShape groundBox;
+    groundBox.SetAsBox(1200.0f, 50.0f);
+
+    groundBody->CreateFixture(&groundBox, 0.0f);
+
+    return groundBody;
+}
+
+b2Body* WaveSimulation::addRock(b2Vec2 position)
+{
+    b2BodyDef rockBody;
+    rockBody.type = b2_staticBody;
+    rockBody.position.Set(position.x, position.y);
+
+    b2Body* rockBd = world->CreateBody(&rockBody);
+
+    b2PolygonShape rockBox;
+    rockBox.SetAsBox(90.0f, 50.0f);
+
+    b2FixtureDef fixture;
+    fixture.shape = &rockBox;
+    fixture.density = 0.0f;
+    fixture.friction = 0.8f;
+    fixture.restitution = 0.1f;
+    rockBd->CreateFixture(&fixture);
+
+    b2Vec2 rockPos = rockBd->GetPosition();
+    levelItems.push_back(ObjectData(rockPos,ObjectType::Rock));
+
+    levelObjects.push_back(rockBd);
+
+    return rockBd;
+}
+
+b2Body* WaveSimulation::addTree(b2Vec2 position)
+{
+    b2BodyDef treeBody;
+    treeBody.type = b2_staticBody;
+    treeBody.position.Set(position.x, position.y);
+
+    b2Body* treeBd = world->CreateBody(&treeBody);
+
+    b2PolygonShape treeBox;
+    treeBox.SetAsBox(90.0f, 70.0f);
+
+    b2FixtureDef fixture;
+    fixture.shape = &treeBox;
+    fixture.density = 0.0f;
+    fixture.friction = 0.8f;
+    fixture.restitution = 0.1f;
+    treeBd->CreateFixture(&fixture);
+
+    b2Vec2 treePos = treeBd->GetPosition();
+    levelItems.push_back(ObjectData(treePos,ObjectType::Tree));
+
+    levelObjects.push_back(treeBd);
+
+    return treeBd;
+}
+
+b2Body* WaveSimulation::addHill(b2Vec2 position)
+{
+    b2BodyDef hillBody;
+    hillBody.type = b2_staticBody;
+    hillBody.position.Set(position.x, position.y);
+
+    b2Body* hillBd = world->CreateBody(&hillBody);
+
+    b2PolygonShape hillBox;
+    hillBox.SetAsBox(250.0f, 150.0f);
+
+    b2FixtureDef fixture;
+    fixture.shape = &hillBox;
+    fixture.density = 0.0f;
+    fixture.friction = 0.8f;
+    fixture.restitution = 0.1f;
+    hillBd->CreateFixture(&fixture);
+
+    b2Vec2 hillPos = hillBd->GetPosition();
+    levelItems.push_back(ObjectData(hillPos,ObjectType::Hill));
+
+    levelObjects.push_back(hillBd);
+    return hillBd;
+}
+
+b2Body* WaveSimulation::addHuman(b2Vec2 position)
+{
+    b2BodyDef humanBody;
+    humanBody.type = b2_staticBody;
+    humanBody.position.Set(position.x, position.y);
+
+    b2Body* humanBd = world->CreateBody(&humanBody);
+
+    b2PolygonShape humanBox;
+    humanBox.SetAsBox(50.0f, 40.0f);
+
+    b2FixtureDef fixture;
+    fixture.shape = &humanBox;
+    fixture.density = 0.0f;
+    fixture.friction = 0.8f;
+    fixture.restitution = 0.1f;
+    humanBd->CreateFixture(&fixture);
+
+    b2Vec2 humanPos = humanBd->GetPosition();
+    levelItems.push_back(ObjectData(humanPos,ObjectType::Human));
+
+    levelObjects.push_back(humanBd);
+
+    return humanBd;
+}
+
+void WaveSimulation::stepSimulation()
+{
+    if (continuousWave)
+    {
+        driveContinuousWave();
+    }
+
+    if (propagationMode == PropagationMode::FdtdGrid)
+    {
+        fdtdSolver->step(deltaTime);
+    }
+    else
+    {
+        world->Step(deltaTime, 6, 2);
+    }
+    ++stepIndex;
+    updateProbes();
+
+    if (trajectory)
+    {
+        readParticlePositions(trajectoryPositions);
+        trajectory->append(stepIndex, trajectoryPositions.data(), restPositions.data());
+    }
+}
+
+void WaveSimulation::step()
+{
+    triggeredProbes.clear();
+    readParticlePositions(particleFrames.writeSlot().previousPositions);
+    stepSimulation();
+    publishParticleFrame(true);
+}
+
+int WaveSimulation::advance(float elapsedSeconds)
+{
+    triggeredProbes.clear();
+
+    // Fall behind rather than spiral: time beyond the sub-step cap is dropped.
+    timeAccumulator += std::max(0.0f, elapsedSeconds);
+    int steps = int(timeAccumulator / deltaTime);
+    if (steps > maxSubSteps)
+    {
+        steps = maxSubSteps;
+        timeAccumulator = steps * deltaTime;
+    }
+
+    for (int i = 0; i < steps; ++i)
+    {
+        // Only the last two states are published, for the view to blend.
+        if (i == steps - 1)
+        {
+            readParticlePositions(particleFrames.writeSlot().previousPositions);
+        }
+        stepSimulation();
+    }
+    timeAccumulator -= steps * deltaTime;
+
+    if (steps > 0)
+    {
+        publishParticleFrame(true);
+    }
+    return steps;
+}
+
+float WaveSimulation::getInterpolationAlpha() const
+{
+    return std::min(1.0f, timeAccumulator / deltaTime);
+}
+
+void WaveSimulation::setStepRate(float stepsPerSecond)
+{
+    deltaTime = 1.0f / stepsPerSecond;
+    timeAccumulator = 0.0f;
+}
+
+void WaveSimulation::setMaxSubSteps(int steps)
+{
+    maxSubSteps = std::max(1, steps);
+}
+
+unsigned long long WaveSimulation::getStepIndex() const
+{
+    return stepIndex;
+}
+
+unsigned long long WaveSimulation::getStateHash() const
+{
+    // 64-bit FNV-1a over the raw bytes of the state.
+    unsigned long long hash = 14695981039346656037ull;
+    auto add = [&hash](const void* data, size_t size)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+
+    add(&stepIndex, sizeof(stepIndex));
+    add(&carrierPhase, sizeof(carrierPhase));
+    add(&propagationMode, sizeof(propagationMode));
+
+    std::vector<b2Vec2> positions;
+    readParticlePositions(positions);
+    add(positions.data(), positions.size() * sizeof(b2Vec2));
+
+    if (fdtdSolver)
+    {
+        // Both time levels of the whole field, since the positions only
+        // sample its gradient at the lattice nodes. The row padding is skipped.
+        const float* levels[2] = {fdtdSolver->field(), fdtdSolver->previousField()};
+        for (const float* level : levels)
+        {
+            for (int row = 0; row < fdtdSolver->rows(); ++row)
+            {
+                add(level + size_t(row) * fdtdSolver->stride(), size_t(fdtdSolver->columns()) * sizeof(float));
+            }
+        }
+    }
+    // The mesh velocities are stale while the grid engine runs.
+    if (propagationMode == PropagationMode::ParticleMesh)
+    {
+        add(particleSystem->GetVelocityBuffer() + particleMesh->GetBufferIndex(),
+            particleMesh->GetParticleCount() * sizeof(b2Vec2));
+    }
+
+    for (const ReceiverProbe& probe : probes)
+    {
+        add(&probe.amplitude, sizeof(probe.amplitude));
+        add(&probe.triggered, sizeof(probe.triggered));
+    }
+    return hash;
+}
+
+bool WaveSimulation::startTrajectory(const std::string& path)
+{
+    TrajectoryLattice lattice;
+    lattice.origin = latticeIndex.position(0);
+    lattice.spacing = latticeIndex.spacing();
+    lattice.columns = latticeIndex.columns();
+    lattice.rows = latticeIndex.rows();
+    lattice.deltaTime = deltaTime;
+
+    trajectory.reset(new TrajectoryRecorder());
+    if (!trajectory->open(path, lattice))
+    {
+        trajectory.reset();
+        return false;
+    }
+    readParticlePositions(trajectoryPositions);
+    trajectory->append(stepIndex, trajectoryPositions.data(), restPositions.data());
+    return true;
+}
+
+void WaveSimulation::stopTrajectory()
+{
+    trajectory.reset();
+}
+
+void WaveSimulation::resetLevel(int levelNumber)
+{
+    // Only the level objects are rebuilt. The world, the ground and the
+    // particle mesh are kept and put back to rest.
+    deleteAddedObjects();
+    particleSystem->ResetParticleGroup(particleMesh);
+    if (fdtdSolver)
+    {
+        fdtdSolver->reset();
+    }
+    carrierPhase = 0.0f;
+    timeAccumulator = 0.0f;
+
+    m_levelNumber = levelNumber;
+    setUpLevel(LevelWorlds::createLevel(levelNumber));
+    publishParticleFrame(false);
+}
+
+void WaveSimulation::deleteAddedObjects()
+{
+    for (b2Body* body : levelObjects)
+    {
+        world->DestroyBody(body);
+    }
+    levelObjects.clear();
+    coverageMap->setObstacles(world, std::vector<std::pair<const b2Body*, float>>());
+    probes.clear();
+    triggeredProbes.clear();
+    levelItems.clear();
+    rasterizeObstacles();
+    updatePreviewReceivers();
+}
+
+void WaveSimulation::setAntennaHeight(int height)
+{
+    antennaHeight = height;
+    setAntennaLocation(antennaHeight);
+}
+
+void WaveSimulation::setAntennaLocation(int antennaHeight)
+{
+    transmitLocation = b2Vec2(playerLocation.x, playerLocation.y - antennaHeight * 10);
+}
+
+void WaveSimulation::setTransmitPower(int powerLevel)
+{
+    transmitPower = powerLevel;
+}
+
+void WaveSimulation::setFrequencyBand(const std::string& frequency)
+{
+    frequencyBand = frequency;
+
+    // The carrier frequencies are scaled down to rates the lattice can carry.
+    if (frequency == "HF") {
+        waveSpeed = 1.0;  // Low frequency, slower wave propagation
+        carrierFrequency = 0.5f;
+    } else if (frequency == "VHF") {
+        waveSpeed = 2.0;  // Moderate speed
+        carrierFrequency = 1.0f;
+    } else if (frequency == "UHF") {
+        waveSpeed = 3.0;  // High speed
+        carrierFrequency = 1.5f;
+    } else if (frequency == "SHF") {
+        waveSpeed = 4.0;  // Very high speed
+        carrierFrequency = 2.0f;
+    }
+}
+
+void WaveSimulation::setAntennaType(const std::string& antenna)
+{
+    if (antenna == "dish") {
+        beamWidth = 10;   // Narrow beam
+        waveSpeed = 30.0; // High speed for long-range
+    } else if (antenna == "yagi") {
+        beamWidth = 45;   // Moderate beam
+        waveSpeed = 20.0; // Medium speed for mid-range
+    } else if (antenna == "dipole") {
+        beamWidth = 360;  // Omnidirectional
+        waveSpeed = 10.0; // Low speed for short-range
+    }
+}
+
+void WaveSimulation::setAntennaOrientation(int angleDegrees)
+{
+    float angleRadians = angleDegrees * (b2_pi / 180.0f);
+
+    float x = std::sin(angleRadians);
+    float y = std::cos(angleRadians);
+
+    transmitDirection = b2Vec2(x, y);
+}
+
+const WaveSimulation::BeamFootprint& WaveSimulation::updateBeamFootprint(BeamFootprint& beam, float radius)
+{
+    if (beam.radius == radius && beam.beamWidth == beamWidth &&
+        beam.center == transmitLocation && beam.direction == transmitDirection)
+    {
+        return beam;
+    }
+
+    beam.center = transmitLocation;
+    beam.direction = transmitDirection;
+    beam.radius = radius;
+    beam.beamWidth = beamWidth;
+    beam.minCos = std::cos(0.5f * beamWidth * (b2_pi / 180.0f));
+    beam.spanStarts.clear();
+    beam.spanLengths.clear();
+    beam.directions.clear();
+
+    // Only the lattice rows and columns overlapping the beam's bounding box
+    // are visited, using the rest positions of the regular lattice.
+    const uint32* flags = particleSystem->GetFlagsBuffer();
+    const int columns = latticeIndex.columns();
+    const int32 firstIndex = particleMesh->GetBufferIndex();
+    const LatticeIndex::Range cells = latticeIndex.range(transmitLocation, radius);
+
+    for (int row = cells.firstRow; row <= cells.lastRow; ++row)
+    {
+        int32 runLength = 0;
+        for (int column = cells.firstColumn; column <= cells.lastColumn + 1; ++column)
+        {
+            int32 particle = firstIndex + row * columns + column;
+            bool inside = false;
+            b2Vec2 direction(0.0f, 0.0f);
+
+            if (column <= cells.lastColumn && !(flags[particle] & b2_wallParticle))
+            {
+                direction = restPositions[particle - firstIndex] - transmitLocation;
+                float distance = direction.Normalize();
+                inside = distance <= radius && b2Dot(transmitDirection, direction) >= beam.minCos;
+            }
+
+            if (inside)
+            {
+                if (runLength == 0)
+                {
+                    beam.spanStarts.push_back(particle);
+                }
+                beam.directions.push_back(direction);
+                ++runLength;
+            }
+            else if (runLength > 0)
+            {
+                beam.spanLengths.push_back(runLength);
+                runLength = 0;
+            }
+        }
+    }
+
+    return beam;
+}
+
+void WaveSimulation::applyBeam(const BeamFootprint& beam, float speed)
+{
+    // Each run is a contiguous slice of the velocity buffer, written as a
+    // flat array of floats so the loop vectorises.
+    float* velocities = reinterpret_cast<float*>(particleSystem->GetVelocityBuffer());
+    const float* directions = reinterpret_cast<const float*>(beam.directions.data());
+    for (size_t span = 0; span < beam.spanStarts.size(); ++span)
+    {
+        float* velocity = velocities + 2 * beam.spanStarts[span];
+        const int32 count = 2 * beam.spanLengths[span];
+        for (int32 i = 0; i < count; ++i)
+        {
+            velocity[i] = speed * directions[i];
+        }
+        directions += count;
+        particleSystem->WakeParticles(beam.spanStarts[span], beam.spanLengths[span]);
+    }
+}
+
+void WaveSimulation::emitWave()
+{
+    float radius = getTransmissionRadius();
+    const BeamFootprint& beam = updateBeamFootprint(beamFootprint, radius);
+    float speed = getTransmissionSpeed();
+
+    if (propagationMode == PropagationMode::FdtdGrid)
+    {
+        fdtdSolver->addRadialKick(transmitLocation, radius, speed, transmitDirection,
+                                  beam.minCos, deltaTime);
+        return;
+    }
+
+    applyBeam(beam, speed);
+}
+
+b2AABB WaveSimulation::getGridBounds() const
+{
+    b2AABB bounds;
+    bounds.lowerBound = latticeIndex.position(0);
+    bounds.upperBound = latticeIndex.position(latticeIndex.nodeCount() - 1);
+    return bounds;
+}
+
+float WaveSimulation::getTransmissionRadius() const
+{
+    // Adjust radius based on power level
+    int baseRadius = 50; // Base range of the wave
+    return float(baseRadius + (transmitPower * 2)); // Increase range with power
+}
+
+float WaveSimulation::getTransmissionSpeed()
+{
+    // The mesh is kicked at most at maxParticleSpeed, so the grid is too.
+    float gain = waveSpeed * calculateScalingFactor() * (transmitPower / 100.0f);
+    return std::min(gain, maxParticleSpeed);
+}
+
+const std::vector<ResponsePrediction>& WaveSimulation::previewTransmission(int steps)
+{
+    if (!linearResponse)
+    {
+        // Same medium as the grid engine.
+        b2AABB bounds = getGridBounds();
+        linearResponse.reset(new LinearResponse(bounds.lowerBound, bounds.upperBound, fdtdCellSize, deltaTime));
+        linearResponse->setAbsorbingLayer((absorbingCells + 1) * latticeIndex.spacing(), absorbingDamping);
+        linearResponse->setThreadCount(previewThreadCount);
+        updatePreviewReceivers();
+    }
+    linearResponse->setHorizon(steps);
+
+    float speed = getTransmissionSpeed();
+    linearResponse->predict(transmitLocation, getTransmissionRadius(), speed, transmitDirection, beamWidth,
+                            probeThreshold, previewPredictions);
+    return previewPredictions;
+}
+
+void WaveSimulation::setPreviewThreadCount(int threads)
+{
+    previewThreadCount = threads;
+    if (linearResponse)
+    {
+        linearResponse->setThreadCount(threads);
+    }
+}
+
+void WaveSimulation::updatePreviewReceivers()
+{
+    if (!linearResponse)
+    {
+        return;
+    }
+
+    std::vector<std::vector<b2Vec2>> receivers(probes.size());
+    for (size_t i = 0; i < probes.size(); ++i)
+    {
+        for (int32 node : probes[i].nodes)
+        {
+            receivers[i].push_back(restPositions[node]);
+        }
+    }
+    linearResponse->setReceivers(receivers);
+}
+
+void WaveSimulation::setContinuousWave(bool enabled)
+{
+    continuousWave = enabled;
+    carrierPhase = 0.0f;
+}
+
+bool WaveSimulation::isContinuousWave() const
+{
+    return continuousWave;
+}
+
+void WaveSimulation::driveContinuousWave()
+{
+    // The source is the antenna's base disc. Its footprint is cached like the
+    // transmission beam, so a step only touches the source nodes.
+    const float sourceRadius = 50.0f;
+    const BeamFootprint& source = updateBeamFootprint(sourceFootprint, sourceRadius);
+
+    // Peak source speed, up to the largest speed the mesh solver accepts.
+    float amplitude = (std::max(1, std::min(transmitPower, 100)) / 100.0f) * maxParticleSpeed;
+    float omega = 2.0f * b2_pi * carrierFrequency;
+
+    if (propagationMode == PropagationMode::FdtdGrid)
+    {
+        // The grid adds kicks to the field velocity, so it is driven with the
+        // derivative of the source speed to reach the same peak speed.
+        fdtdSolver->addRadialKick(transmitLocation, sourceRadius, amplitude * omega * deltaTime * std::cos(carrierPhase),
+                                  transmitDirection, source.minCos, deltaTime);
+    }
+    else
+    {
+        applyBeam(source, amplitude * std::sin(carrierPhase));
+    }
+
+    // Keep the phase wrapped so it stays accurate however long the source runs.
+    carrierPhase = std::fmod(carrierPhase + omega * deltaTime, 2.0f * b2_pi);
+}
+
+float WaveSimulation::calculateScalingFactor() {
+    int p_min = 1;
+    int p_max = 100;
+
+    float s_min = 100000.0f;
+    float s_max = 1000000000.0f; // max scaling factor
+
+    if (transmitPower < p_min) transmitPower = p_min;
+    if (transmitPower > p_max) transmitPower = p_max;
+
+    // exponential mapping (power to scaling factor)
+    //float scalingFactor = s_min + (s_max - s_min) * pow((transmitPower - p_min) / (float)(p_max - p_min), n);
+    //float scalingFactor = (s_max - s_min) * pow((transmitPower - p_min) / (float)(p_max - p_min), n);
+
+    // logarithmic mapping
+    //float scalingFactor = s_min + (s_max - s_min) * (log(transmitPower + 1) / log(p_max + 1)) / alpha;
+    //float scalingFactor = s_min + (s_max - s_min) * (log((transmitPower + alpha) / alpha) / log((p_max + alpha) / alpha));
+
+    // linear mapping
+    float scalingFactor = (s_min / 100) + (s_max - s_min) * ((transmitPower - p_min) / (float)(p_max - p_min));
+
+    return scalingFactor;
+}
+
+LevelWorlds::LevelWorlds(const std::vector<ObjectData> &obj)
+    : obj(obj) {}
+
+std::string LevelWorlds::getBackgroundPath() const {
+    return backgroundPath;
+}
+
+const std::vector<ObjectData>& LevelWorlds::getObjects() const {
+    return obj;
+}
+
+LevelWorlds LevelWorlds::createLevel(int levelNumber) {
+    switch (levelNumber) {
+    case 1:
+        return createLevel1();
+    case 2:
+        return createLevel2();
+    case 3:
+        return createLevel3();
+    case 4:
+        return createLevel4();
+    case 5:
+        return createLevel5();
+    default:
+        return LevelWorlds({});
+    }
+}
+
+// Level World
+LevelWorlds LevelWorlds::createLevel1() {
+    std::vector<ObjectData> objects= {
+         {{b2Vec2(150.0f, 700.0f)},  ObjectType::Human},
+         {{b2Vec2(420.0f, 300.0f)},  ObjectType::Human}
+    };
+    return LevelWorlds(objects);
+}
+
+LevelWorlds LevelWorlds::createLevel2() {
+    std::vector<ObjectData> objects= {
+        {{b2Vec2(150.0f, 700.0f)},  ObjectType::Human},
+        {{b2Vec2(1000.0f, 700.0f)},  ObjectType::Human}
+    };
+    return LevelWorlds(objects);
+}
+
+LevelWorlds LevelWorlds::createLevel3() {
+    std::vector<ObjectData> objects = {
+        {{b2Vec2(740.0f,300.0f)} , ObjectType::Hill},
+        {{b2Vec2(150.0f, 700.0f)},  ObjectType::Human},
+        {{b2Vec2(630.0f, 350.0f)},  ObjectType::Human}
+        //{{b2Vec2(320.0f, 750.0f)},  ObjectType::Human}
+    };
+    return LevelWorlds(objects);
+}
+
+LevelWorlds LevelWorlds::createLevel4() {
+    std::vector<ObjectData> objects= {
+        {{b2Vec2(800.0f,300.0f)} , ObjectType::Hill},
+        {{b2Vec2(150.0f, 700.0f)},  ObjectType::Human},
+        {{b2Vec2(1000.0f, 700.0f)},  ObjectType::Human}
+    };
+    return LevelWorlds(objects);
+}
+
+LevelWorlds LevelWorlds::createLevel5() {
+    std::vector<ObjectData> objects= {
+        {{b2Vec2(150.0f, 700.0f)},  ObjectType::Human},
+        {{b2Vec2(1000.0f, 700.0f)},  ObjectType::Human},
+        //{{b2Vec2(320.0f, 700.0f)},  ObjectType::Human},
+        {{b2Vec2(500.0f, 750.0f)}, ObjectType::Rock},
+        {{b2Vec2(550.0f, 570.0f)}, ObjectType::Tree}
+    };
+    return LevelWorlds(objects);
+}
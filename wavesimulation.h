@@ -0,0 +1,292 @@
+/**
+ * @file WaveSimulation.h
+ * @brief This class is the headless simulation engine behind the model.
+ * It owns the Box2D world, the particle mesh, the level objects and the antenna
+ * state, and advances the wave propagation one step at a time. It has no Qt
+ * dependency so it can run in batch jobs, benchmarks and worker threads without
+ * a QApplication.
+ *
+ * @author: Trentton Stratton, Phuc Hoang, Chanphone Visathip, Thu Ha.
+ * @date: 12/12/2024
+ */
+
+#ifndef WAVESIMULATION_H
+#define WAVESIMULATION_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Box2D/Box2D.h"
+#include "coveragemap.h"
+#include "fdtdsolver.h"
+#include "latticeindex.h"
+#include "linearresponse.h"
+#include "snapshotbuffer.h"
+#include "trajectoryfile.h"
+
+// Enumeration for different types of game objects.
+enum ObjectType
+{
+    Rock,
+    Tree,
+    Hill,
+    Human
+};
+
+// Structure to store object data including position and type.
+struct ObjectData
+{
+    b2Vec2 objPos;
+    ObjectType type;
+    ObjectData(b2Vec2 position, ObjectType objType) : objPos(position), type(objType) {}
+};
+
+// Class describing the objects placed in a specific level.
+class LevelWorlds
+{
+public:
+    LevelWorlds(const std::vector<ObjectData> &obj);
+    std::string getBackgroundPath() const;
+    const std::vector<ObjectData>& getObjects() const;
+
+    // Static methods to create specific level configurations.
+    static LevelWorlds createLevel(int levelNumber);
+    static LevelWorlds createLevel1();
+    static LevelWorlds createLevel2();
+    static LevelWorlds createLevel3();
+    static LevelWorlds createLevel4();
+    static LevelWorlds createLevel5();
+
+private:
+    std::string backgroundPath;
+    std::vector<ObjectData> obj;
+};
+
+// Engines available for propagating the radio wave.
+enum class PropagationMode
+{
+    ParticleMesh,  // Box2D mass-spring particle lattice
+    FdtdGrid       // Finite-difference solver of the scalar wave equation
+};
+
+// One published set of particle positions.
+struct ParticleFrame
+{
+    std::vector<b2Vec2> positions;  // Particle positions, in lattice order
+    std::vector<b2Vec2> previousPositions;  // Particle positions one step earlier
+    unsigned long long stepIndex = 0;  // Number of steps taken when the frame was published
+};
+
+// A receiver attached to a human target. It reads the displacement of a few
+// fixed lattice nodes around the target after every step.
+struct ReceiverProbe
+{
+    b2Vec2 position;  // Position of the target
+    std::vector<int32> nodes;  // Lattice nodes sampled by the probe
+    float amplitude = 0.0f;  // Largest node displacement after the last step
+    bool triggered = false;  // Latched once the amplitude reaches the threshold
+};
+
+// The WaveSimulation class runs the game's physical simulation.
+class WaveSimulation
+{
+public:
+    explicit WaveSimulation(int levelNumber);
+    ~WaveSimulation();
+
+    WaveSimulation(const WaveSimulation&) = delete;
+    WaveSimulation& operator=(const WaveSimulation&) = delete;
+
+    // Simulation properties
+    float deltaTime;  // Length of one fixed step, in seconds
+    int windowWidth;
+    int windowHeight;
+
+    // Radio transmission settings
+    b2Vec2 transmitLocation;
+    b2Vec2 transmitDirection;
+    b2Vec2 playerLocation;
+    int antennaHeight = 5;
+    int transmitPower = 1;
+    float beamWidth = 360.0f;  // Default to omnidirectional
+    float waveSpeed = 1.0f;    // Default wave speed
+    float carrierFrequency = 1.0f;  // Source frequency of the continuous wave, in Hz
+    std::string frequencyBand;
+
+    // Methods for particle mesh and game object management
+    void addParticleMesh(int particleSpacing, int particleSize, int windowWidth, int windowHeight);
+    b2Body* addGround(b2Vec2 position);
+    b2Body* addSky(b2Vec2 position);
+    b2Body* addRock(b2Vec2 position);
+    b2Body* addTree(b2Vec2 position);
+    b2Body* addHill(b2Vec2 position);
+    b2Body* addHuman(b2Vec2 position);
+    void setUpLevel(const LevelWorlds& level);
+    void deleteAddedObjects();
+
+    // Swaps in the objects of another level and puts the wave medium back to
+    // rest, keeping the world, the mesh and the radio settings.
+    void resetLevel(int levelNumber);
+
+    // Advances the world by one fixed time step.
+    void step();
+
+    /**
+     * Advances the world in fixed steps by the real time elapsed since the
+     * last call. Leftover time is carried to the next call; time beyond
+     * maxSubSteps steps is dropped so a slow frame cannot snowball.
+     * @param elapsedSeconds The real time elapsed since the last call.
+     * @return The number of steps taken.
+     */
+    int advance(float elapsedSeconds);
+    // Fraction of a step left in the accumulator, for blending the previous
+    // and current positions of the latest frame.
+    float getInterpolationAlpha() const;
+    void setStepRate(float stepsPerSecond);
+    void setMaxSubSteps(int steps);
+    // Number of steps taken since construction.
+    unsigned long long getStepIndex() const;
+    // Hash of the whole wave state, for checking that two runs agree bit for bit.
+    unsigned long long getStateHash() const;
+
+    // Streams the node displacements after every step to a trajectory file,
+    // starting with the current state, until stopTrajectory() or destruction.
+    bool startTrajectory(const std::string& path);
+    void stopTrajectory();
+
+    // Selects the engine used to propagate the wave. Both engines report the
+    // field as displaced particle positions on the same lattice.
+    void setPropagationMode(PropagationMode mode);
+    PropagationMode getPropagationMode() const;
+
+    // Kicks the particles inside the antenna beam.
+    void emitWave();
+
+    // Turns the continuous-wave transmitter on or off. While it is on, every
+    // step drives the source nodes sinusoidally at the carrier frequency.
+    void setContinuousWave(bool enabled);
+    bool isContinuousWave() const;
+    float calculateScalingFactor();
+
+    /**
+     * Predicts what emitWave would do at each probe over the next steps of the
+     * grid engine, without simulating it. The responses behind the prediction
+     * are cached per antenna position and power, so changing the orientation,
+     * the antenna type or the band afterwards is instant.
+     * @param steps The number of steps to look ahead.
+     * @return One prediction per probe, in the order of getProbes().
+     */
+    const std::vector<ResponsePrediction>& previewTransmission(int steps);
+    // Sets the number of threads used to build preview responses; 0 uses every core.
+    void setPreviewThreadCount(int threads);
+
+    // Receiver probes of the current level, one per human target other than the player.
+    const std::vector<ReceiverProbe>& getProbes() const;
+    // Indices of the probes whose threshold was crossed during the last step.
+    const std::vector<int>& getTriggeredProbes() const;
+    // Sets the displacement a probe must see to trigger.
+    void setProbeThreshold(float threshold);
+    float getProbeThreshold() const;
+    // Re-arms every probe.
+    void resetProbes();
+
+    // Radio settings adjustments
+    void setAntennaHeight(int height);
+    void setAntennaLocation(int antennaHeight);
+    void setTransmitPower(int powerLevel);
+    void setFrequencyBand(const std::string& frequency);
+    void setAntennaType(const std::string& antenna);
+    void setAntennaOrientation(int angleDegrees);
+
+    // Received-power map of the level for the current antenna configuration,
+    // brought up to date on demand.
+    const CoverageMap& getCoverage();
+    // Loss in dB at the VHF band of a signal crossing an object of the given type.
+    static float getObstacleLoss(ObjectType type);
+
+    // Mesh particles near a point, found from the rest positions of the
+    // lattice. The indices are positions in the particle frame.
+    int32 findClosestParticle(b2Vec2 point) const;
+    void findClosestParticles(b2Vec2 point, int count, std::vector<int32>& particles) const;
+    void findParticlesInRadius(b2Vec2 center, float radius, std::vector<int32>& particles) const;
+    // Layout of the mesh lattice, which never changes after construction.
+    const LatticeIndex& getLatticeIndex() const;
+
+    // Latest published particle frame. It is read from a triple buffer, so the
+    // reference stays valid until the next call to either getter and is never
+    // written to while it is held.
+    const ParticleFrame& getParticleFrame();
+    const std::vector<b2Vec2>& getParticlePositions();
+    // Data about the objects in the current level.
+    const std::vector<ObjectData>& getLevelItems() const;
+    int getLevelNumber() const;
+
+private:
+    // Lattice particles inside the antenna beam, cached for one antenna
+    // configuration. The particles are stored as runs of consecutive buffer
+    // indices so a transmission writes the velocity buffer span by span.
+    struct BeamFootprint
+    {
+        b2Vec2 center = b2Vec2(0.0f, 0.0f);
+        b2Vec2 direction = b2Vec2(0.0f, 0.0f);
+        float radius = -1.0f;
+        float beamWidth = 0.0f;
+        float minCos = -1.0f;  // Cosine of half the beam width
+        std::vector<int32> spanStarts;  // First particle index of each run
+        std::vector<int32> spanLengths;  // Number of particles in each run
+        std::vector<b2Vec2> directions;  // Unit kick direction of each particle, run after run
+    };
+
+    void stepSimulation();
+    void readParticlePositions(std::vector<b2Vec2>& positions) const;
+    b2Vec2 getNodeDisplacement(int32 node) const;
+    void publishParticleFrame(bool interpolate);
+    void addProbe(b2Vec2 position);
+    void updateProbes();
+    const BeamFootprint& updateBeamFootprint(BeamFootprint& beam, float radius);
+    void applyBeam(const BeamFootprint& beam, float speed);
+    void driveContinuousWave();
+    void rasterizeObstacles();
+    void updatePreviewReceivers();
+    // World area of the grid engines: the mesh lattice, pinned border included.
+    b2AABB getGridBounds() const;
+    float getTransmissionRadius() const;
+    float getTransmissionSpeed();
+
+    b2World* world;  // The Box2D world for the simulation
+    std::vector<b2Body*> levelObjects;  // Bodies representing game objects
+    std::unique_ptr<CoverageMap> coverageMap;  // Cached received power over the level
+    std::vector<ReceiverProbe> probes;  // Receivers at the human targets
+    std::vector<int> triggeredProbes;  // Probes triggered during the last step
+    float probeThreshold = 2.0f;  // Displacement that triggers a probe
+    BeamFootprint beamFootprint;  // Particles kicked by the current antenna configuration
+    BeamFootprint sourceFootprint;  // Particles driven by the continuous-wave source
+    bool continuousWave = false;  // Whether the continuous-wave source is on
+    float carrierPhase = 0.0f;  // Phase of the continuous-wave source, in [0, 2 pi)
+    b2ParticleSystem* particleSystem;  // Particles and spring links of the wave medium
+    b2ParticleGroup* particleMesh;  // The lattice group representing the particle mesh
+    SnapshotBuffer<ParticleFrame> particleFrames;  // Particle positions handed to the view
+    unsigned long long stepIndex = 0;  // Number of steps taken since construction
+    float timeAccumulator = 0.0f;  // Real time not yet simulated, in seconds
+    int maxSubSteps = 8;  // Most steps advance() takes in one call
+    float maxParticleSpeed = 120.0f;  // Fastest kick, one maximum translation per step at 60 Hz
+    std::vector<b2Vec2> restPositions;  // Rest positions of the particle mesh
+    LatticeIndex latticeIndex;  // Proximity index over the rest positions
+    int absorbingCells = 4;  // Depth of the absorbing layer along the mesh edges, in lattice spacings
+    float absorbingDamping = 20.0f;  // Damping rate of the layer next to the edges, in 1/s
+    float meshWaveSpeed = 0.0f;  // Approximate wave speed of the mesh, in pixels per second
+    std::vector<float> meshDamping;  // Damping of the bare mesh: its absorbing layer
+    std::vector<float> nodeDamping;  // Damping of the mesh with the level's obstacles
+    PropagationMode propagationMode = PropagationMode::ParticleMesh;
+    std::unique_ptr<FdtdSolver> fdtdSolver;  // Grid engine, created on first use
+    float fdtdCellSize = 5.0f;  // Grid resolution of the FDTD engine
+    std::unique_ptr<LinearResponse> linearResponse;  // Transmission previews, created on first use
+    std::vector<ResponsePrediction> previewPredictions;  // Result of the last preview
+    int previewThreadCount = 0;  // Threads building preview responses
+    std::unique_ptr<TrajectoryRecorder> trajectory;  // Trajectory file, while recording
+    std::vector<b2Vec2> trajectoryPositions;  // Scratch space of the trajectory frames
+    std::vector<ObjectData> levelItems;  // Data about the objects in the current level
+    int m_levelNumber;  // The current level number
+};
+
+#endif // WAVESIMULATION_H